@@ -34,8 +34,15 @@
  * -------------------------------------------------------------------------- */
 #pragma once
 #include <hydra/backend/backend_module.h>
+#include <hydra_msgs/QueryFreespace.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 #include "hydra_ros/utils/dsg_streaming_interface.h"
+#include "hydra_ros/utils/freespace_index.h"
+#include "hydra_ros/utils/sink_worker.h"
 
 namespace hydra {
 
@@ -49,6 +56,8 @@ class RosBackendPublisher : public BackendModule::Sink {
             const DynamicSceneGraph& graph,
             const kimera_pgmo::DeformationGraph& dgraph) const override;
 
+  inline const DsgSender& getSender() const { return *dsg_sender_; }
+
  protected:
   virtual void publishPoseGraph(const DynamicSceneGraph& graph,
                                 const kimera_pgmo::DeformationGraph& dgraph) const;
@@ -56,12 +65,32 @@ class RosBackendPublisher : public BackendModule::Sink {
   virtual void publishDeformationGraphViz(const kimera_pgmo::DeformationGraph& dgraph,
                                           size_t timestamp_ns) const;
 
+  void updateFreespaceIndex(const DynamicSceneGraph& graph) const;
+
+  //! Whether a freespace query arrived recently enough to keep the index up to date
+  bool freespaceQueriesActive() const;
+
+  bool handleFreespaceQuery(hydra_msgs::QueryFreespace::Request& req,
+                            hydra_msgs::QueryFreespace::Response& res);
+
  protected:
   ros::NodeHandle nh_;
   ros::Publisher mesh_mesh_edges_pub_;
   ros::Publisher pose_mesh_edges_pub_;
   ros::Publisher pose_graph_pub_;
   std::unique_ptr<DsgSender> dsg_sender_;
+
+  mutable std::mutex freespace_mutex_;
+  mutable std::condition_variable freespace_cv_;
+  mutable std::unique_ptr<FreespaceIndex> freespace_index_;
+  mutable uint64_t freespace_version_ = 0;
+  std::atomic<int64_t> last_query_ns_{0};
+  double freespace_active_s_ = 10.0;
+  double freespace_query_timeout_s_ = 2.0;
+  ros::ServiceServer freespace_service_;
+
+  // declared last so that pending jobs finish before anything they use is destroyed
+  std::unique_ptr<SinkWorker> worker_;
 };
 
 }  // namespace hydra
@@ -38,6 +38,8 @@
 #include <hydra/places/gvd_voxel.h>
 #include <hydra_ros/GvdVisualizerConfig.h>
 
+#include <atomic>
+
 #include "hydra_ros/visualizer/visualizer_types.h"
 
 namespace hydra {
@@ -46,6 +48,7 @@ class GraphExtractorInterface;
 class GvdGraph;
 }  // namespace places
 
+class GvdMarkerCache;
 class MarkerGroupPub;
 
 using hydra_ros::GvdVisualizerConfig;
@@ -84,6 +87,9 @@ class PlacesVisualizer : public GvdPlaceExtractor::Sink {
   void visualizeGraph(const std_msgs::Header& header,
                       const SceneGraphLayer& graph) const;
 
+  //! Record the hash of what a topic shows, returning false if it is unchanged
+  bool hasChanged(const std::string& topic, size_t hash) const;
+
   void visualizeGvd(const std_msgs::Header& header,
                     const places::GvdLayer& gvd) const;
 
@@ -94,10 +100,12 @@ class PlacesVisualizer : public GvdPlaceExtractor::Sink {
                        const places::GvdLayer& gvd) const;
 
   void publishGraphLabels(const std_msgs::Header& header,
-                          const SceneGraphLayer& graph) const;
+                          const SceneGraphLayer& graph,
+                          size_t graph_hash) const;
 
   void publishFreespace(const std_msgs::Header& header,
-                        const SceneGraphLayer& graph) const;
+                        const SceneGraphLayer& graph,
+                        size_t graph_hash) const;
 
   void gvdConfigCb(GvdVisualizerConfig& config, uint32_t level);
 
@@ -120,9 +128,17 @@ class PlacesVisualizer : public GvdPlaceExtractor::Sink {
   Config config_;
   ros::NodeHandle nh_;
   std::unique_ptr<MarkerGroupPub> pubs_;
+  ros::Publisher esdf_grid_pub_;
+  std::unique_ptr<GvdMarkerCache> gvd_cache_;
+
+  //! Set by the config servers (on their own thread), which invalidates every
+  //! cached marker
+  mutable std::atomic<bool> config_changed_;
+  mutable std::map<std::string, size_t> published_hashes_;
 
   mutable std::set<int> previous_labels_;
-  mutable size_t previous_spheres_;
+  //! Position and radius hash of each place sphere that was last published
+  mutable std::unordered_map<NodeId, size_t> published_spheres_;
   mutable bool published_gvd_graph_;
   mutable bool published_gvd_clusters_;
 
@@ -37,6 +37,7 @@
 #include <ros/ros.h>
 
 #include "hydra_ros/utils/dsg_streaming_interface.h"
+#include "hydra_ros/utils/sink_worker.h"
 
 namespace hydra {
 
@@ -54,6 +55,8 @@ class RosFrontendPublisher : public FrontendModule::Sink {
   std::unique_ptr<DsgSender> dsg_sender_;
   ros::Publisher mesh_graph_pub_;
   ros::Publisher mesh_update_pub_;
+  // declared last so that pending jobs finish before anything they use is destroyed
+  std::unique_ptr<SinkWorker> worker_;
 };
 
 }  // namespace hydra
@@ -34,6 +34,7 @@
  * -------------------------------------------------------------------------- */
 #pragma once
 #include <hydra/common/hydra_pipeline.h>
+#include <hydra_msgs/GetDsg.h>
 #include <ros/ros.h>
 
 #include "hydra_ros/input/ros_input_module.h"
@@ -41,6 +42,7 @@
 namespace hydra {
 
 class BowSubscriber;
+class RosBackendPublisher;
 
 struct HydraRosConfig {
   bool enable_frontend_output = true;
@@ -63,10 +65,15 @@ class HydraRosPipeline : public HydraPipeline {
   virtual void initReconstruction();
   virtual void initLCD();
 
+  bool handleGetDsg(hydra_msgs::GetDsg::Request& req,
+                    hydra_msgs::GetDsg::Response& res);
+
  protected:
   const HydraRosConfig config_;
   ros::NodeHandle nh_;
   std::unique_ptr<BowSubscriber> bow_sub_;
+  std::shared_ptr<RosBackendPublisher> backend_publisher_;
+  ros::ServiceServer get_dsg_service_;
 };
 
 }  // namespace hydra
@@ -57,6 +57,9 @@ class ReconstructionVisualizer : public ReconstructionModule::Sink {
     ColormapConfig colors;
   };
 
+  //! Per-block slices from the last call (defined in the source file)
+  struct SliceCache;
+
   explicit ReconstructionVisualizer(const Config& config);
 
   virtual ~ReconstructionVisualizer();
@@ -72,6 +75,10 @@ class ReconstructionVisualizer : public ReconstructionModule::Sink {
   Config config_;
   ros::NodeHandle nh_;
   std::unique_ptr<MarkerGroupPub> pubs_;
+  //! Slices as grids of colormap ratios (much smaller than the marker slices)
+  ros::Publisher distance_grid_pub_;
+  ros::Publisher weight_grid_pub_;
+  std::unique_ptr<SliceCache> cache_;
 
  private:
   inline static const auto registration_ =
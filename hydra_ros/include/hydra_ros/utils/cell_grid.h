@@ -0,0 +1,233 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#pragma once
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace hydra {
+
+inline int floorDiv(int value, int divisor) {
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+inline int wrap(int value, int size) {
+  const int result = value % size;
+  return result < 0 ? result + size : result;
+}
+
+/**
+ * @brief 2D grid of occupancy cells (in voxel x-y indices) that covers block columns
+ *
+ * The grid either grows in chunks to cover new block columns or is a fixed window
+ * around the robot that is stored with wrap-around indexing in ring, so that moving
+ * the window only resets the cells that became visible.
+ */
+struct CellGrid {
+  using Index = Eigen::Vector2i;
+
+  static constexpr size_t INVALID = std::numeric_limits<size_t>::max();
+
+  //! Region of the grid (in cells relative to the origin) covered by block columns
+  struct Bounds {
+    Index min = Index::Constant(std::numeric_limits<int>::max());
+    Index max = Index::Constant(std::numeric_limits<int>::lowest());
+
+    bool empty() const { return (max.array() < min.array()).any(); }
+
+    void add(const CellGrid& grid, const Index& column) {
+      const Index rel = column * grid.voxels_per_side - grid.origin;
+      min = min.cwiseMin(rel);
+      max = max.cwiseMax(rel + Index::Constant(grid.voxels_per_side - 1));
+    }
+  };
+
+  float voxel_size = 0.0f;
+  int voxels_per_side = 0;
+  //! First cell of the grid and grid size in cells
+  Index origin = Index::Zero();
+  Index size = Index::Zero();
+  //! Whether the grid is a window stored in ring (and unwrapped into data)
+  bool rolling = false;
+  std::vector<int8_t> ring;
+  //! Cells in row-major order starting from the origin
+  std::vector<int8_t> data;
+
+  void reset() {
+    origin = Index::Zero();
+    size = Index::Zero();
+    rolling = false;
+    ring.clear();
+    data.clear();
+  }
+
+  inline std::vector<int8_t>& cells() { return rolling ? ring : data; }
+
+  inline size_t cellIndex(const Index& cell) const {
+    const Index rel = cell - origin;
+    if ((rel.array() < 0).any() || (rel.array() >= size.array()).any()) {
+      return INVALID;
+    }
+
+    if (rolling) {
+      return wrap(cell.y(), size.y()) * size.x() + wrap(cell.x(), size.x());
+    }
+
+    return rel.y() * size.x() + rel.x();
+  }
+
+  //! Whether any cell of the block column is inside the grid
+  inline bool overlaps(const Index& column) const {
+    const Index lower = column * voxels_per_side - origin;
+    const Index upper = lower + Index::Constant(voxels_per_side);
+    return (upper.array() > 0).all() && (lower.array() < size.array()).all();
+  }
+
+  //! Grow the grid in chunks so that it contains the columns, returning true on resize
+  bool grow(const Index& needed_min, const Index& needed_max, int chunk) {
+    Index new_min;
+    Index new_max;
+    for (int i = 0; i < 2; ++i) {
+      new_min(i) = floorDiv(needed_min(i), chunk) * chunk * voxels_per_side;
+      new_max(i) = (floorDiv(needed_max(i), chunk) + 1) * chunk * voxels_per_side;
+    }
+
+    if (size.prod() > 0) {
+      const Index old_max = origin + size;
+      new_min = new_min.cwiseMin(origin);
+      new_max = new_max.cwiseMax(old_max);
+      if (new_min == origin && new_max == old_max) {
+        return false;
+      }
+    }
+
+    const Index new_size = new_max - new_min;
+    std::vector<int8_t> new_data(new_size.prod(), -1);
+    const Index offset = origin - new_min;
+    for (int r = 0; r < size.y(); ++r) {
+      const auto src = data.begin() + r * size.x();
+      const auto dest = new_data.begin() + (r + offset.y()) * new_size.x() + offset.x();
+      std::copy(src, src + size.x(), dest);
+    }
+
+    origin = new_min;
+    size = new_size;
+    data.swap(new_data);
+    return true;
+  }
+
+  //! Allocate a window of the given size (in cells) centered on the position
+  void initWindow(const Index& window_size, const Eigen::Vector2d& position) {
+    rolling = true;
+    size = window_size;
+    origin = getWindowOrigin(position);
+    ring.assign(size.prod(), -1);
+    data.resize(size.prod());
+  }
+
+  inline Index getWindowOrigin(const Eigen::Vector2d& position) const {
+    const Index center = (position / voxel_size).array().floor().cast<int>().matrix();
+    return center - size / 2;
+  }
+
+  //! Center the window on the position, resetting only the cells that became visible
+  bool recenter(const Eigen::Vector2d& position) {
+    const Index old_origin = origin;
+    origin = getWindowOrigin(position);
+    if (origin == old_origin) {
+      return false;
+    }
+
+    const Index old_max = old_origin + size;
+    for (int y = origin.y(); y < origin.y() + size.y(); ++y) {
+      const bool old_row = y >= old_origin.y() && y < old_max.y();
+      for (int x = origin.x(); x < origin.x() + size.x(); ++x) {
+        if (old_row && x >= old_origin.x() && x < old_max.x()) {
+          x = old_max.x() - 1;  // skip the cells that were already visible
+          continue;
+        }
+
+        ring[cellIndex(Index(x, y))] = -1;
+      }
+    }
+
+    return true;
+  }
+
+  //! Whether a column has cells that were not visible before the window moved
+  inline bool newlyVisible(const Index& column, const Index& old_origin) const {
+    const Index lower = column * voxels_per_side - old_origin;
+    const Index upper = lower + Index::Constant(voxels_per_side);
+    return overlaps(column) &&
+           ((lower.array() < 0).any() || (upper.array() > size.array()).any());
+  }
+
+  //! Copy the window into data starting from the window origin
+  void unwrap() {
+    const int split = wrap(origin.x(), size.x());
+    for (int r = 0; r < size.y(); ++r) {
+      const auto src = ring.begin() + wrap(origin.y() + r, size.y()) * size.x();
+      auto dest = data.begin() + r * size.x();
+      dest = std::copy(src + split, src + size.x(), dest);
+      std::copy(src, src + split, dest);
+    }
+  }
+
+  //! Copy the cells inside the bounds (clipped to the grid) in row-major order
+  Bounds copyRegion(const Bounds& bounds, std::vector<int8_t>& region) const {
+    Bounds clipped;
+    clipped.min = bounds.min.cwiseMax(Index::Zero());
+    clipped.max = bounds.max.cwiseMin(size - Index::Ones());
+    if (clipped.empty()) {
+      region.clear();
+      return clipped;
+    }
+
+    const Index region_size = clipped.max - clipped.min + Index::Ones();
+    region.resize(region_size.prod());
+    for (int r = 0; r < region_size.y(); ++r) {
+      const size_t start = (r + clipped.min.y()) * size.x() + clipped.min.x();
+      const auto src = data.begin() + start;
+      std::copy(src, src + region_size.x(), region.begin() + r * region_size.x());
+    }
+
+    return clipped;
+  }
+};
+
+}  // namespace hydra
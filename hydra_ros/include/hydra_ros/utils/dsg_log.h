@@ -0,0 +1,173 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hydra {
+
+struct DsgLogRecord {
+  uint64_t stamp_ns = 0;
+  int64_t sequence_number = 0;
+  bool full_update = true;
+  std::vector<uint8_t> contents;
+  //! Nodes removed by an incremental update
+  std::vector<uint64_t> deleted_nodes;
+  //! Source and target of every edge removed by an incremental update
+  std::vector<uint64_t> deleted_edges;
+};
+
+/**
+ * @brief Append-only binary log of serialized scene graph updates
+ *
+ * Each record stores the update timestamp, sequence number, the serialized graph
+ * exactly as it was sent and the nodes and edges it removed. Full updates are
+ * keyframes: their timestamp and file offset are also appended to a small index file
+ * next to the log so that readers can seek without scanning the log.
+ */
+class DsgLogWriter {
+ public:
+  explicit DsgLogWriter(const std::string& path);
+
+  ~DsgLogWriter();
+
+  bool write(uint64_t stamp_ns,
+             int64_t sequence_number,
+             bool full_update,
+             const uint8_t* data,
+             size_t size,
+             const std::vector<uint64_t>& deleted_nodes = {},
+             const std::vector<uint64_t>& deleted_edges = {});
+
+  void flush();
+
+  inline const std::string& path() const { return path_; }
+
+  inline size_t numRecords() const { return num_records_; }
+
+  //! Size of the log (excluding the index) in bytes
+  inline size_t size() const { return size_; }
+
+  static std::string indexPath(const std::string& log_path);
+
+ private:
+  std::string path_;
+  std::ofstream log_;
+  std::ofstream index_;
+  size_t num_records_;
+  size_t size_;
+};
+
+/**
+ * @brief Sequential reader for logs written by DsgLogWriter
+ *
+ * The keyframe index is loaded if present and consistent with the log; otherwise it
+ * is rebuilt by skipping through the record headers. Logs from before deletions were
+ * recorded are still read (without any deletions).
+ */
+class DsgLogReader {
+ public:
+  struct Keyframe {
+    uint64_t stamp_ns;
+    uint64_t offset;
+  };
+
+  using ViewCallback = std::function<void(const uint8_t*, size_t)>;
+
+  explicit DsgLogReader(const std::string& path);
+
+  ~DsgLogReader();
+
+  DsgLogReader(const DsgLogReader& other) = delete;
+
+  DsgLogReader& operator=(const DsgLogReader& other) = delete;
+
+  inline bool valid() const { return valid_; }
+
+  //! Read the next record, returns false at the end of the log (or a truncated record)
+  bool next(DsgLogRecord& record);
+
+  /**
+   * @brief Move to the latest keyframe at or before the requested time
+   *
+   * Times before the first keyframe go to the first keyframe.
+   * @returns False if the log has no keyframes
+   */
+  bool seek(uint64_t stamp_ns);
+
+  void rewind();
+
+  //! Index of the latest keyframe at or before the requested time
+  std::optional<size_t> findKeyframe(uint64_t stamp_ns) const;
+
+  /**
+   * @brief Run the callback on the contents of a keyframe without copying them
+   *
+   * The log is memory-mapped on first use, so only the pages of the requested
+   * keyframe are read from disk.
+   * @returns False if the keyframe is invalid or the log could not be mapped
+   */
+  bool viewKeyframe(size_t index, const ViewCallback& callback) const;
+
+  std::optional<uint64_t> startTime() const;
+
+  //! Timestamp of the last keyframe in the log
+  std::optional<uint64_t> endTime() const;
+
+  inline const std::vector<Keyframe>& keyframes() const { return keyframes_; }
+
+ private:
+  bool loadIndex();
+
+  void buildIndex();
+
+  bool map() const;
+
+  std::string path_;
+  mutable std::ifstream log_;
+  uint64_t log_size_;
+  bool valid_;
+  //! Whether the log predates deletions being recorded
+  bool legacy_;
+  std::vector<Keyframe> keyframes_;
+  mutable void* mapping_;
+};
+
+}  // namespace hydra
@@ -34,11 +34,22 @@
  * -------------------------------------------------------------------------- */
 #pragma once
 #include <hydra/common/dsg_types.h>
+#include <hydra_msgs/DsgReceiverStats.h>
 #include <hydra_msgs/DsgUpdate.h>
+#include <hydra_msgs/SharedDsgUpdate.h>
 #include <kimera_pgmo_msgs/KimeraPgmoMesh.h>
 #include <ros/ros.h>
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <utility>
+#include <vector>
+
+#include "hydra_ros/utils/shared_memory_ring.h"
+#include "hydra_ros/utils/sink_worker.h"
 
 namespace hydra {
 
@@ -53,18 +64,92 @@ class DsgSender {
 
   void sendGraph(const DynamicSceneGraph& graph, const ros::Time& stamp) const;
 
+  /**
+   * @brief Serialize the graph without sending it
+   *
+   * Lets callers that hold a lock on the graph only pay for the serialization while
+   * holding it and send the result with sendSerialized() from another thread. The
+   * serialized bytes are written into buffers recycled from released messages.
+   */
+  hydra_msgs::DsgUpdate::Ptr serializeUpdate(const DynamicSceneGraph& graph,
+                                             const ros::Time& stamp) const;
+
+  //! Send a graph from serializeUpdate() as the next full update
+  void sendSerialized(const hydra_msgs::DsgUpdate::Ptr& msg) const;
+
+  //! Publish the mesh of the graph if enabled (sendGraph() already does this)
+  void sendMesh(const DynamicSceneGraph& graph, const ros::Time& stamp) const;
+
+  /**
+   * @brief Send only what changed since the last update
+   *
+   * Receivers apply the changes on top of their current graph and request the full
+   * graph if they miss an update. If the changes could not be sent because nobody was
+   * subscribed, the next update sends the full graph instead.
+   * @param graph Full graph after the changes
+   * @param delta Nodes and edges that were added or modified
+   * @param deleted_nodes Nodes that were removed
+   * @param deleted_edges Source and target of every edge that was removed
+   */
+  void sendUpdate(const DynamicSceneGraph& graph,
+                  const DynamicSceneGraph& delta,
+                  const std::vector<NodeId>& deleted_nodes,
+                  const std::vector<std::pair<NodeId, NodeId>>& deleted_edges,
+                  const ros::Time& stamp) const;
+
+  //! Whether or not sendGraph will serialize the graph
+  bool hasSubscribers() const;
+
+  /**
+   * @brief Get the serialized graph from the last call to sendGraph
+   * @returns Cached message or nullptr if the graph changed without being serialized
+   */
+  hydra_msgs::DsgUpdate::ConstPtr getCachedGraph() const;
+
+  /**
+   * @brief Serialize the graph and cache the result until the next call to sendGraph
+   *
+   * The cache only ever moves forward: if sendGraph cached or invalidated a newer
+   * graph in the meantime, the older serialization is not stored.
+   */
+  hydra_msgs::DsgUpdate::ConstPtr cacheGraph(const DynamicSceneGraph& graph,
+                                             const ros::Time& stamp) const;
+
  private:
+  struct BufferPool;
+
+  hydra_msgs::DsgUpdate::Ptr serializeGraph(const DynamicSceneGraph& graph,
+                                            const ros::Time& stamp,
+                                            int64_t sequence_number) const;
+
+  void publishUpdate(const hydra_msgs::DsgUpdate::Ptr& msg) const;
+
+  void sendShared(const hydra_msgs::DsgUpdate& msg) const;
+
   ros::NodeHandle nh_;
   std::string frame_id_;
 
   ros::Publisher pub_;
   ros::Publisher mesh_pub_;
+  ros::Publisher shared_pub_;
+  SharedMemoryRing::Ptr shared_ring_;
   mutable std::optional<uint64_t> last_mesh_time_ns_;
 
   std::string timer_name_;
   bool publish_mesh_;
   double min_mesh_separation_s_;
   bool serialize_dsg_mesh_;
+
+  std::shared_ptr<BufferPool> buffers_;
+
+  mutable std::mutex cache_mutex_;
+  mutable hydra_msgs::DsgUpdate::ConstPtr cached_msg_;
+  mutable int64_t cached_version_;
+  // incremented for every graph change, whether or not it gets serialized
+  mutable std::atomic<int64_t> graph_version_;
+  // incremented for every update that is sent
+  mutable std::atomic<int64_t> sequence_number_;
+  mutable std::atomic<bool> needs_full_update_;
 };
 
 class DsgReceiver {
@@ -75,26 +160,94 @@ class DsgReceiver {
 
   DsgReceiver(const ros::NodeHandle& nh, const LogCallback& cb);
 
-  inline DynamicSceneGraph::Ptr graph() const { return graph_; }
+  ~DsgReceiver();
+
+  /**
+   * @brief Get the most recent graph
+   *
+   * Updates are applied to a second graph and swapped in once complete, so the
+   * returned graph is never modified by the receiver (other than its mesh). Once every
+   * copy of a replaced graph is released, it is reused for the next update. The
+   * pointer changes between updates: callers should fetch it again after
+   * consumeUpdate().
+   */
+  DynamicSceneGraph::Ptr graph() const;
+
+  /**
+   * @brief Check for and clear the update flag in one step
+   *
+   * Call before graph() so that an update applied in between is not lost.
+   */
+  inline bool consumeUpdate() { return has_update_.exchange(false); }
 
-  inline bool updated() const { return has_update_; }
+  //! Sequence number of the last update applied to the graph
+  std::optional<int64_t> sequenceNumber() const;
 
-  inline void clearUpdated() { has_update_ = false; }
+  hydra_msgs::DsgReceiverStats stats() const;
 
  private:
   void handleUpdate(const hydra_msgs::DsgUpdate::ConstPtr& msg);
 
+  void handleSharedUpdate(const hydra_msgs::SharedDsgUpdate::ConstPtr& msg);
+
+  void processUpdate(const hydra_msgs::DsgUpdate::ConstPtr& msg);
+
+  void processSharedUpdate(const hydra_msgs::SharedDsgUpdate::ConstPtr& msg);
+
+  bool applyUpdate(const std_msgs::Header& header,
+                   int64_t sequence_number,
+                   bool full_update,
+                   const uint8_t* buffer,
+                   size_t length,
+                   const std::vector<uint64_t>& deleted_nodes = {},
+                   const std::vector<uint64_t>& deleted_edges = {});
+
+  void resync(const std::string& reason);
+
+  //! Bring a graph from an earlier update up to date with the current graph
+  bool replayUpdates(DynamicSceneGraph& graph, uint64_t graph_version) const;
+
+  //! Wrap the graph so that it returns to the pool once every copy is released
+  DynamicSceneGraph::Ptr makeRecyclable(const DynamicSceneGraph::Ptr& graph,
+                                        uint64_t version) const;
+
+  //! Count the update and any gap before it, before the worker coalesces updates
+  void countReceived(int64_t sequence_number);
+
+  void publishStats();
+
   void handleMesh(const kimera_pgmo_msgs::KimeraPgmoMesh::ConstPtr& msg);
 
   ros::NodeHandle nh_;
   ros::Subscriber sub_;
+  SharedMemoryRing::Ptr shared_ring_;
   ros::Subscriber mesh_sub_;
-
-  bool has_update_;
+  ros::Publisher stats_pub_;
+  ros::WallTimer stats_timer_;
+  ros::ServiceClient resync_client_;
+
+  std::atomic<bool> has_update_;
+  std::atomic<uint64_t> num_received_;
+  hydra_msgs::DsgReceiverStats stats_;
+  std::optional<int64_t> last_received_;
+  mutable std::mutex graph_mutex_;
+  std::optional<int64_t> sequence_number_;
   DynamicSceneGraph::Ptr graph_;
+  // replaced graphs that nobody holds anymore, reused for the next update
+  struct GraphPool;
+  std::shared_ptr<GraphPool> pool_;
+
+  // incremental updates since the last full update, replayed onto the reused graph
+  // (only touched by the thread applying updates)
+  struct Delta;
+  std::deque<Delta> history_;
+  uint64_t version_ = 0;
+  uint64_t base_version_ = 0;
   Mesh::Ptr mesh_;
 
   std::unique_ptr<LogCallback> log_callback_;
+  // declared last so that pending updates finish before anything they use is destroyed
+  std::unique_ptr<SinkWorker> worker_;
 };
 
 }  // namespace hydra
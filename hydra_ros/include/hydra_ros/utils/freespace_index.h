@@ -0,0 +1,118 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#pragma once
+#include <hydra/common/dsg_types.h>
+
+#include <unordered_map>
+
+#include "hydra_ros/utils/index_hash.h"
+
+namespace hydra {
+
+/**
+ * @brief Voxel-hash over place spheres (position and free-space radius) for fast
+ * batched free-space checks
+ *
+ * Each place is stored in every cell its bounding box overlaps, so queries only check
+ * the spheres of the cell containing the point. The cell size should be on the order
+ * of the typical place radius.
+ */
+class FreespaceIndex {
+ public:
+  using CellIndex = Eigen::Vector3i;
+
+  struct Sphere {
+    Eigen::Vector3d center;
+    double radius;
+  };
+
+  explicit FreespaceIndex(double cell_size = 2.0);
+
+  /**
+   * @brief Sync the index with the places in the layer
+   *
+   * Only spheres that were added, moved or removed since the last call touch the hash.
+   * @returns Number of spheres that changed
+   */
+  size_t update(const SceneGraphLayer& places);
+
+  void insert(NodeId node, const Eigen::Vector3d& center, double radius);
+
+  void erase(NodeId node);
+
+  void clear();
+
+  inline size_t size() const { return spheres_.size(); }
+
+  inline double cellSize() const { return cell_size_; }
+
+  /**
+   * @brief Check whether the point has at least the requested clearance
+   * @param point Query point
+   * @param min_clearance Distance the point has to be inside a sphere
+   */
+  bool inFreespace(const Eigen::Vector3d& point, double min_clearance = 0.0) const;
+
+  /**
+   * @brief Batched version of inFreespace
+   *
+   * Points that fall into the same cell share candidate spheres and are checked
+   * against them together.
+   * @param points 3xN matrix of query points
+   * @param min_clearance Distance each point has to be inside a sphere
+   */
+  std::vector<int8_t> batchInFreespace(const Eigen::Matrix3Xd& points,
+                                       double min_clearance = 0.0) const;
+
+ private:
+  CellIndex toCell(const Eigen::Vector3d& point) const;
+
+  // inserts or removes the node from every cell the sphere overlaps
+  void insertIntoCells(NodeId node, const Sphere& sphere);
+
+  void eraseFromCells(NodeId node, const Sphere& sphere);
+
+  // gathers the spheres overlapping the cell
+  void getCandidates(const CellIndex& cell,
+                     Eigen::Matrix3Xd& centers,
+                     Eigen::VectorXd& radii) const;
+
+ private:
+  double cell_size_;
+  std::unordered_map<NodeId, Sphere> spheres_;
+  std::unordered_map<CellIndex, std::vector<NodeId>, IndexHash> cells_;
+};
+
+}  // namespace hydra
@@ -39,8 +39,13 @@
 #include <hydra/reconstruction/reconstruction_module.h>
 #include <ros/ros.h>
 
+#include "hydra_ros/utils/task_pool.h"
+
 namespace hydra {
 
+template <typename LayerT>
+class LayerCollator;
+
 class OccupancyPublisher {
  public:
   struct Config {
@@ -52,8 +57,35 @@ class OccupancyPublisher {
     bool add_robot_footprint = false;
     Eigen::Vector3f footprint_min;
     Eigen::Vector3f footprint_max;
+    //! Size that the grid grows by when new blocks are outside of it
+    double chunk_size = 10.0;
+    //! Publish changed cells on occupancy_updates and only resend the full grid when
+    //! needed (e.g., after a resize) instead of publishing the full grid every time
+    bool publish_updates = false;
+    //! Extra threads used to fill changed block columns (0 fills them in order)
+    size_t num_threads = 0;
+    //! Size of a window centered on the robot to publish instead of the whole layer
+    //! (only used when both are positive)
+    double window_width = 0.0;
+    double window_height = 0.0;
+    //! Publish a 2.5D elevation map from the voxels between these heights (relative
+    //! to the same reference as slice_height)
+    bool publish_elevation = false;
+    double elevation_min_height = -1.5;
+    double elevation_max_height = 1.0;
+    //! Voxels at or below this distance are part of a surface in the elevation map
+    double elevation_surface_distance = 0.0;
+    //! Largest side of the elevation map (centered on the robot) without a window
+    double elevation_max_extent = 50.0;
+    //! Free space needed above the ground and largest height difference to a
+    //! neighboring cell for a cell to be traversable
+    double robot_height = 1.0;
+    double max_step_height = 0.2;
   } const config;
 
+  //! Persistent grid that is updated from changed blocks (defined in the source file)
+  struct State;
+
   OccupancyPublisher(const Config& config, const ros::NodeHandle& nh);
 
   virtual ~OccupancyPublisher();
@@ -67,8 +99,22 @@ class OccupancyPublisher {
                   const places::GvdLayer& gvd) const;
 
  private:
+  template <typename BlockT>
+  void publishLayer(uint64_t timestamp_ns,
+                    const Eigen::Isometry3d& world_T_sensor,
+                    const spatial_hash::VoxelLayer<BlockT>& layer) const;
+
+  template <typename BlockT>
+  void publishElevation(uint64_t timestamp_ns,
+                        const Eigen::Isometry3d& world_T_sensor,
+                        const spatial_hash::VoxelLayer<BlockT>& layer) const;
+
   ros::NodeHandle nh_;
   ros::Publisher pub_;
+  ros::Publisher update_pub_;
+  ros::Publisher elevation_pub_;
+  std::unique_ptr<State> state_;
+  std::unique_ptr<TaskPool> pool_;
 };
 
 class TsdfOccupancyPublisher : public ReconstructionModule::Sink {
@@ -77,11 +123,15 @@ class TsdfOccupancyPublisher : public ReconstructionModule::Sink {
     std::string ns = "~tsdf";
     OccupancyPublisher::Config extraction;
     bool collate = false;
+    //! Drop collated blocks farther than this from the sensor (0 keeps all blocks)
+    double max_collated_distance = 0.0;
+    //! Drop the least recently updated collated blocks past this count (0 keeps all)
+    size_t max_collated_blocks = 0;
   } const config;
 
   explicit TsdfOccupancyPublisher(const Config& config);
 
-  virtual ~TsdfOccupancyPublisher() = default;
+  virtual ~TsdfOccupancyPublisher();
 
   void call(uint64_t timestamp_ns,
             const Eigen::Isometry3d& world_T_sensor,
@@ -90,7 +140,7 @@ class TsdfOccupancyPublisher : public ReconstructionModule::Sink {
 
  private:
   OccupancyPublisher pub_;
-  mutable TsdfLayer::Ptr tsdf_;
+  mutable std::unique_ptr<LayerCollator<TsdfLayer>> collator_;
 
   inline static const auto registration_ =
       config::RegistrationWithConfig<ReconstructionModule::Sink,
@@ -104,11 +154,15 @@ class GvdOccupancyPublisher : public GvdPlaceExtractor::Sink {
     std::string ns = "~gvd";
     OccupancyPublisher::Config extraction;
     bool collate = false;
+    //! Drop collated blocks farther than this from the sensor (0 keeps all blocks)
+    double max_collated_distance = 0.0;
+    //! Drop the least recently updated collated blocks past this count (0 keeps all)
+    size_t max_collated_blocks = 0;
   } const config;
 
   explicit GvdOccupancyPublisher(const Config& config);
 
-  virtual ~GvdOccupancyPublisher() = default;
+  virtual ~GvdOccupancyPublisher();
 
   void call(uint64_t timestamp_ns,
             const Eigen::Isometry3f& world_T_sensor,
@@ -117,7 +171,7 @@ class GvdOccupancyPublisher : public GvdPlaceExtractor::Sink {
 
  private:
   OccupancyPublisher pub_;
-  mutable places::GvdLayer::Ptr gvd_;
+  mutable std::unique_ptr<LayerCollator<places::GvdLayer>> collator_;
 
   inline static const auto registration_ =
       config::RegistrationWithConfig<GvdPlaceExtractor::Sink,
@@ -0,0 +1,138 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace hydra {
+
+/**
+ * @brief Fixed set of byte slots in a POSIX shared memory segment
+ *
+ * One process creates the segment and writes serialized data into the slots in a
+ * round-robin fashion. Other processes on the same host open the segment and read
+ * slots in place using the slot index and version returned by write. Each slot is
+ * guarded by a version counter (odd while a write is in progress) and a reader count,
+ * so writers skip slots that are being read and readers reject slots that were
+ * overwritten. A reader that crashes mid-read would pin its slot forever, so writers
+ * reclaim slots that have been busy for longer than the reader timeout.
+ */
+class SharedMemoryRing {
+ public:
+  using Ptr = std::unique_ptr<SharedMemoryRing>;
+  using ReadCallback = std::function<void(const uint8_t*, size_t)>;
+
+  struct Token {
+    uint32_t slot;
+    uint64_t version;
+  };
+
+  ~SharedMemoryRing();
+
+  SharedMemoryRing(const SharedMemoryRing& other) = delete;
+
+  SharedMemoryRing& operator=(const SharedMemoryRing& other) = delete;
+
+  /**
+   * @brief Create (or replace) a segment and take ownership of it
+   * @param name Segment name (must start with '/' and contain no other '/')
+   * @param num_slots Number of slots to cycle through
+   * @param slot_capacity Maximum size in bytes of a single write
+   * @param reader_timeout_s Time after which a slot is reclaimed from its readers
+   */
+  static Ptr create(const std::string& name,
+                    size_t num_slots,
+                    size_t slot_capacity,
+                    double reader_timeout_s = 5.0);
+
+  /**
+   * @brief Open an existing segment for reading
+   * @returns nullptr if the segment does not exist or is invalid
+   */
+  static Ptr open(const std::string& name);
+
+  /**
+   * @brief Convert an arbitrary string (e.g., a topic) to a valid segment name
+   */
+  static std::string segmentName(const std::string& name);
+
+  /**
+   * @brief Copy the data into the next free slot
+   * @returns Token for the slot or nothing if the data was too large or every slot
+   * was being read
+   */
+  std::optional<Token> write(const uint8_t* data, size_t size);
+
+  /**
+   * @brief Run the callback on the slot contents without copying them
+   *
+   * A read that outlasts the writer's reader timeout may see its slot reclaimed; the
+   * version is checked again afterwards so such reads are reported as failed.
+   * @returns False if the slot was overwritten before or during the read
+   */
+  bool read(const Token& token, const ReadCallback& callback) const;
+
+  inline const std::string& name() const { return name_; }
+
+  size_t numSlots() const;
+
+  size_t slotCapacity() const;
+
+  //! Unique per call to create: detects segments replaced under the same name
+  uint64_t instanceId() const;
+
+ private:
+  struct Header;
+  struct SlotHeader;
+
+  SharedMemoryRing(const std::string& name, void* data, size_t size, bool owner);
+
+  SlotHeader* slot(size_t index) const;
+
+  // true if the slot was busy for longer than the reader timeout and was taken over
+  bool reclaimSlot(SlotHeader& slot_header, size_t index) const;
+
+  std::string name_;
+  void* data_;
+  size_t size_;
+  bool owner_;
+  int64_t reader_timeout_ns_;
+};
+
+}  // namespace hydra
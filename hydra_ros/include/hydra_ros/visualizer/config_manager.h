@@ -36,6 +36,8 @@
 #include <dynamic_reconfigure/server.h>
 #include <ros/ros.h>
 
+#include <mutex>
+
 #include "hydra_ros/visualizer/visualizer_types.h"
 
 namespace hydra {
@@ -108,6 +110,8 @@ class ConfigManager {
  private:
   ros::NodeHandle nh_;
 
+  //! Guards the config maps, which getters fill lazily from parallel draws
+  mutable std::mutex mutex_;
   mutable ConfigWrapper<VisualizerConfig>::Ptr visualizer_config_;
   mutable std::map<LayerId, ConfigWrapper<LayerConfig>::Ptr> layer_configs_;
   mutable std::map<LayerId, ConfigWrapper<DynamicLayerConfig>::Ptr>
@@ -36,10 +36,14 @@
 #include <ros/ros.h>
 #include <visualization_msgs/MarkerArray.h>
 
+#include <deque>
 #include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "hydra_ros/utils/task_pool.h"
 #include "hydra_ros/visualizer/config_manager.h"
 #include "hydra_ros/visualizer/dsg_visualizer_plugin.h"
 #include "hydra_ros/visualizer/visualizer_types.h"
@@ -92,9 +96,22 @@ class DynamicSceneGraphVisualizer {
   }
 
  protected:
+  //! Markers from a single redraw, grouped by layer or edge type (see getLayerGroup)
+  struct MarkerGroups {
+    //! Get the markers for a group, appending the group if it is new
+    MarkerArray& operator[](const std::string& name);
+
+    auto begin() const { return entries.begin(); }
+
+    auto end() const { return entries.end(); }
+
+    //! Groups in the order they were added (deque keeps references valid)
+    std::deque<std::pair<std::string, MarkerArray>> entries;
+  };
+
   virtual void resetImpl(const std_msgs::Header& header, MarkerArray& msg);
 
-  virtual void redrawImpl(const std_msgs::Header& header, MarkerArray& msg);
+  virtual void redrawImpl(const std_msgs::Header& header, MarkerGroups& groups);
 
   virtual void drawLayer(const std_msgs::Header& header,
                          const SceneGraphLayer& layer,
@@ -111,10 +128,24 @@ class DynamicSceneGraphVisualizer {
                          const std::string& ns,
                          MarkerArray& msg);
 
-  void addMultiMarkerIfValid(const Marker& marker, MarkerArray& msg);
+  void addMultiMarkerIfValid(Marker&& marker, MarkerArray& msg);
 
   void displayLoop(const ros::WallTimerEvent&);
 
+  void handleNewSubscriber(const ros::SingleSubscriberPublisher&);
+
+  /**
+   * @brief Send markers either on a single topic or on one topic per group
+   *
+   * Empty groups are skipped, so with separate topics only changed groups are sent.
+   * With a single topic, the markers of every group are moved into one message.
+   */
+  void publishGroups(MarkerGroups& groups);
+
+  inline std::string getLayerGroup(LayerId layer) const {
+    return "layer_" + std::to_string(layer);
+  }
+
   void deleteLayer(const std_msgs::Header& header,
                    const SceneGraphLayer& layer,
                    MarkerArray& msg);
@@ -179,13 +210,55 @@ class DynamicSceneGraphVisualizer {
 
   Color getParentColor(const SceneGraphNode& node) const;
 
+  ColorFunction getLayerColorFunction(const SceneGraphLayer& layer,
+                                      const LayerConfig& config) const;
+
+  size_t hashLayer(const SceneGraphLayer& layer, const LayerConfig& config) const;
+
+  size_t hashMeshEdges(LayerId layer_id) const;
+
+  void drawInterlayerEdges(const std_msgs::Header& header,
+                           const std::map<LayerId, LayerConfig>& all_configs,
+                           bool layers_changed,
+                           MarkerArray& msg);
+
+  void drawDynamicInterlayerEdges(
+      const std_msgs::Header& header,
+      const std::map<LayerId, LayerConfig>& all_configs,
+      const std::map<LayerId, DynamicLayerConfig>& all_dynamic_configs,
+      MarkerArray& msg);
+
  protected:
+  //! Hash of a layer (or the interlayer edges) from the last time it was drawn
+  struct MarkerCache {
+    bool valid = false;
+    size_t hash = 0;
+  };
+
+  /**
+   * @brief Draw a layer if it changed since it was last drawn
+   *
+   * Layers are drawn in parallel, so this may only modify the layer's own state.
+   * @returns True if the layer was redrawn
+   */
+  bool drawLayerIfChanged(const std_msgs::Header& header,
+                          const SceneGraphLayer& layer,
+                          const LayerConfig& config,
+                          MarkerCache& cache,
+                          MarkerArray& msg);
+
   ros::NodeHandle nh_;
   ros::WallTimer visualizer_loop_timer_;
   ConfigManager::Ptr config_manager_;
 
   bool need_redraw_;
   bool periodic_redraw_;
+  //! Set when configs changed since the last redraw, which invalidates every cache
+  bool config_changed_;
+  //! Redraw every layer on the next redraw (e.g., for a new subscriber)
+  bool redraw_all_;
+  //! Publish each layer and edge group on its own topic instead of dsg_markers
+  bool separate_layer_topics_;
   std::string visualizer_frame_;
   DynamicSceneGraph::Ptr scene_graph_;
   std::map<LayerId, ColorFunction> layer_colors_;
@@ -204,14 +277,26 @@ class DynamicSceneGraphVisualizer {
   const std::string dynamic_edge_ns_prefix_ = "dynamic_edges_";
   const std::string dynamic_label_ns_prefix_ = "dynamic_label_";
 
+  std::mutex published_mutex_;
   std::set<std::string> published_multimarkers_;
   std::map<LayerId, std::set<NodeId>> prev_labels_;
   std::map<LayerId, std::set<NodeId>> curr_labels_;
   std::set<std::string> published_dynamic_labels_;
+  std::map<LayerId, MarkerCache> layer_cache_;
+  std::optional<MarkerCache> interlayer_edge_cache_;
+  //! Hash of the mesh vertices connected to the mesh edge source layer
+  size_t mesh_edges_hash_ = 0;
+  //! Edge markers kept between interlayer edge redraws
+  EdgeMarkerBuffer interlayer_edge_buffer_;
+  EdgeMarkerBuffer dynamic_interlayer_edge_buffer_;
 
   ros::Publisher dsg_pub_;
+  std::map<std::string, ros::Publisher> group_pubs_;
+  //! Group that last published each marker namespace (with separate topics)
+  std::map<std::string, std::string> namespace_groups_;
   ros::Publisher dynamic_layers_viz_pub_;
   std::list<std::shared_ptr<DsgVisualizerPlugin>> plugins_;
+  std::unique_ptr<TaskPool> draw_pool_;
 };
 
 }  // namespace hydra
@@ -37,9 +37,16 @@
 #include <hydra/places/gvd_graph.h>
 #include <hydra/places/gvd_voxel.h>
 #include <hydra_ros/GvdVisualizerConfig.h>
+#include <nav_msgs/OccupancyGrid.h>
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "hydra_ros/utils/index_hash.h"
 #include "hydra_ros/visualizer/visualizer_types.h"
 
 namespace hydra {
@@ -47,20 +54,73 @@ namespace hydra {
 using hydra_ros::GvdVisualizerConfig;
 using CompressedNodeMap = std::unordered_map<uint64_t, places::CompressedNode>;
 
+/**
+ * @brief Lazily advertised marker topics that only build messages when needed
+ *
+ * Builders passed to publish() only run if the topic has subscribers, and the result
+ * is only published if the builder returns true. Topics with a minimum period (the
+ * "<topic>/min_period" parameter in seconds) publish at most once per period: results
+ * built within the period are held back and the latest one is sent when the period
+ * ends (marker arrays are merged so that no markers are dropped). Builds and skipped
+ * builds are counted for every topic of every instance.
+ */
 class MarkerGroupPub {
  public:
   using MarkerCallback = std::function<bool(visualization_msgs::Marker& marker)>;
   using ArrayCallback = std::function<bool(visualization_msgs::MarkerArray& marker)>;
 
+  //! Build counters of a topic (shared by every instance)
+  struct BuildStats;
+
   explicit MarkerGroupPub(const ros::NodeHandle& nh);
 
-  void publish(const std::string& name, const MarkerCallback& marker) const;
+  //! Returns whether the builder ran (i.e., whether it saw the current data)
+  bool publish(const std::string& name, const MarkerCallback& marker) const;
+
+  //! Returns whether the builder ran (i.e., whether it saw the current data)
+  bool publish(const std::string& name, const ArrayCallback& marker) const;
+
+  //! Override the minimum time between messages of a topic (0 disables the limit)
+  void setMinPeriod(const std::string& name, double min_period_s) const;
+
+  //! Summary of the builds that ran or were skipped for every topic
+  static std::string skippedWorkReport();
 
-  void publish(const std::string& name, const ArrayCallback& marker) const;
+  //! Whether anyone is listening to the topic (advertising it if needed)
+  bool hasSubscribers(const std::string& name) const;
+
+  //! Whether anyone subscribed since the last call (clears the flag), which lets
+  //! callers that only publish changes send everything again
+  bool checkNewSubscribers(const std::string& name) const;
 
  private:
+  //! Publisher and the message the callbacks build into
+  struct Topic {
+    ros::Publisher pub;
+    visualization_msgs::MarkerArray msg;
+    std::atomic<bool> new_subscribers{false};
+    std::string resolved_name;
+    double min_period_s = 0.0;
+    std::shared_ptr<BuildStats> stats;
+    //! Guards the fields below, which the trailing timer also uses
+    std::mutex mutex;
+    ros::WallTime last_publish;
+    //! Latest message built within the minimum period
+    visualization_msgs::MarkerArray pending;
+    bool has_pending = false;
+    ros::WallTimer trailing_timer;
+  };
+
+  Topic& advertise(const std::string& name) const;
+
+  Topic* getTopic(const std::string& name) const;
+
+  void send(Topic& topic, bool merge) const;
+
+  static void sendPending(Topic& topic);
+
   mutable ros::NodeHandle nh_;
-  mutable std::map<std::string, ros::Publisher> pubs_;
+  mutable std::map<std::string, Topic> pubs_;
 };
 
 enum class GvdVisualizationMode : int {
@@ -71,10 +131,46 @@ enum class GvdVisualizationMode : int {
 
 GvdVisualizationMode getModeFromString(const std::string& mode);
 
+//! Fill a marker with the GVD, replacing any points it already has
+void fillGvdMarker(const GvdVisualizerConfig& config,
+                   const ColormapConfig& colors,
+                   const places::GvdLayer& layer,
+                   visualization_msgs::Marker& marker);
+
 visualization_msgs::Marker makeGvdMarker(const GvdVisualizerConfig& config,
                                          const ColormapConfig& colors,
                                          const places::GvdLayer& layer);
 
+/**
+ * @brief GVD marker that keeps the voxels of each block between calls
+ *
+ * Only blocks that are new or marked as updated are revisited. The cache has to be
+ * invalidated when the config or colormap change, or when the layer may have changed
+ * without the cache seeing it.
+ */
+class GvdMarkerCache {
+ public:
+  //! Refresh the changed blocks and fill the marker with every cached block
+  void fill(const GvdVisualizerConfig& config,
+            const ColormapConfig& colors,
+            const places::GvdLayer& layer,
+            visualization_msgs::Marker& marker);
+
+  inline void invalidate() {
+    valid_ = false;
+    blocks_.clear();
+  }
+
+ private:
+  struct BlockMarker {
+    std::vector<geometry_msgs::Point> points;
+    std::vector<std_msgs::ColorRGBA> colors;
+  };
+
+  bool valid_ = false;
+  std::unordered_map<spatial_hash::BlockIndex, BlockMarker, IndexHash> blocks_;
+};
+
 visualization_msgs::Marker makeSurfaceVoxelMarker(
     const GvdVisualizerConfig& config,
     const ColormapConfig& colors,
@@ -86,11 +182,39 @@ visualization_msgs::Marker makeErrorMarker(const GvdVisualizerConfig& config,
                                            const places::GvdLayer& rhs,
                                            double threshold);
 
+//! Fill a marker with the ESDF slice, replacing any points it already has
+void fillEsdfMarker(const GvdVisualizerConfig& config,
+                    const ColormapConfig& colors,
+                    const places::GvdLayer& layer,
+                    visualization_msgs::Marker& marker);
+
 visualization_msgs::Marker makeEsdfMarker(
     const GvdVisualizerConfig& config,
     const ColormapConfig& colors,
     const places::GvdLayer& layer);
 
+/**
+ * @brief Reset a slice grid to cover the x-y extent at the height of the slice
+ *
+ * Slice grids are a compact alternative to CUBE_LIST markers: each cell stores the
+ * colormap ratio of its voxel scaled to [0, 100] (or -1 if unobserved), so that the
+ * colors come from the palette of the viewer instead of being sent per voxel.
+ */
+void resetSliceGrid(float voxel_size,
+                    double height,
+                    const Eigen::AlignedBox2f& extent,
+                    nav_msgs::OccupancyGrid& msg);
+
+//! Set the cell of a slice grid that contains the position to the colormap ratio
+void setSliceGridCell(const Eigen::Vector2f& pos,
+                      double ratio,
+                      nav_msgs::OccupancyGrid& msg);
+
+//! Fill a slice grid with the ESDF slice
+void fillEsdfGrid(const GvdVisualizerConfig& config,
+                  const places::GvdLayer& layer,
+                  nav_msgs::OccupancyGrid& msg);
+
 visualization_msgs::Marker makeBlocksMarker(
     const TsdfLayer& layer, double scale);
 
@@ -115,6 +239,12 @@ visualization_msgs::MarkerArray showGvdClusters(
     const std::string& ns,
     size_t marker_id = 0);
 
+//! Free-space sphere of a place (using the node id as the marker id)
+visualization_msgs::Marker makePlaceSphere(const std_msgs::Header& header,
+                                           const SceneGraphNode& node,
+                                           const std::string& ns,
+                                           double alpha = 0.1);
+
 visualization_msgs::MarkerArray makePlaceSpheres(const std_msgs::Header& header,
                                                  const SceneGraphLayer& layer,
                                                  const std::string& ns,
@@ -39,7 +39,9 @@
 #include <spark_dsg/zmq_interface.h>
 #include <std_srvs/Empty.h>
 
+#include <filesystem>
 #include <fstream>
+#include <optional>
 
 #include "hydra_ros/utils/dsg_streaming_interface.h"
 #include "hydra_ros/visualizer/dynamic_scene_graph_visualizer.h"
@@ -59,6 +61,9 @@ struct HydraVisualizerConfig {
   std::string zmq_url = "tcp://127.0.0.1:8001";
   size_t zmq_num_threads = 2;
   size_t zmq_poll_time_ms = 10;
+  // Time (relative to the start) to load when the graph file is a dsg update log.
+  // Negative values load the latest graph in the log
+  double log_time = -1.0;
 
   // Specify additional plugins that should be loaded <name, config>
   std::map<std::string, config::VirtualConfig<DsgVisualizerPlugin>> plugins;
@@ -70,7 +75,12 @@ struct HydraVisualizer {
   HydraVisualizer(const ros::NodeHandle& nh);
   ~HydraVisualizer();
 
-  void loadGraph();
+  /**
+   * @brief Load the graph file
+   * @param force Reload the file even if its size and modification time are unchanged
+   * @returns False if loading failed or the file was unchanged
+   */
+  bool loadGraph(bool force = false);
 
   bool handleReload(std_srvs::Empty::Request&, std_srvs::Empty::Response&);
   bool handleRedraw(std_srvs::Empty::Request&, std_srvs::Empty::Response&);
@@ -92,6 +102,8 @@ struct HydraVisualizer {
   std::unique_ptr<std::ofstream> size_log_file_;
   ros::ServiceServer reload_service_;
   ros::ServiceServer redraw_service_;
+  //! Size and modification time of the last graph file that was loaded
+  std::optional<std::pair<uintmax_t, std::filesystem::file_time_type>> loaded_file_;
 };
 
 }  // namespace hydra
@@ -0,0 +1,123 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#pragma once
+#include <kimera_pgmo/mesh_traits.h>
+
+#include <Eigen/Dense>
+#include <unordered_map>
+#include <vector>
+
+#include "hydra_ros/utils/index_hash.h"
+#include "hydra_ros/visualizer/mesh_color_adaptor.h"
+
+namespace hydra {
+
+/**
+ * @brief Multi-resolution copy of a mesh split into spatial blocks
+ *
+ * Level 0 of each block is the original geometry. Coarser levels are built by vertex
+ * clustering with a voxel size that doubles every level. A level is picked per block
+ * from the distance of the block to a viewpoint, so that only nearby blocks are sent
+ * at full resolution. Rebuilding only decimates blocks whose geometry or colors
+ * changed.
+ */
+class MeshLod {
+ public:
+  struct Config {
+    //! Side length of a block
+    double block_size = 10.0;
+    //! Number of levels (including the original mesh)
+    size_t num_levels = 4;
+    //! Voxel size used to decimate the first coarse level
+    double resolution = 0.1;
+    //! Blocks closer than this use the original mesh; the range doubles every level
+    double lod_distance = 15.0;
+    //! Blocks further away are not drawn (disabled if not positive)
+    double max_distance = 0.0;
+  } const config;
+
+  //! Geometry of a single level of a block (and of the selected mesh)
+  struct Level {
+    std::vector<Eigen::Vector3f> points;
+    std::vector<kimera_pgmo::traits::Color> colors;
+    std::vector<kimera_pgmo::traits::Face> faces;
+
+    void clear();
+
+    bool operator==(const Level& other) const;
+  };
+
+  struct Block {
+    Eigen::Vector3f center;
+    std::vector<Level> levels;
+  };
+
+  using BlockIndex = Eigen::Vector3i;
+  using BlockMap = std::unordered_map<BlockIndex, Block, IndexHash>;
+
+  explicit MeshLod(const Config& config);
+
+  /**
+   * @brief Update the blocks from the mesh (using the adaptor's vertex colors)
+   * @returns Number of blocks that were added or rebuilt
+   */
+  size_t build(const MeshColorAdaptor& mesh);
+
+  //! Collect the blocks at the level of detail required by the viewpoint
+  void select(const Eigen::Vector3f& viewpoint, Level& mesh) const;
+
+  size_t levelFor(double distance) const;
+
+  inline const BlockMap& blocks() const { return blocks_; }
+
+ private:
+  void decimate(const Level& original, double voxel_size, Level& level) const;
+
+  BlockMap blocks_;
+};
+
+void declare_config(MeshLod::Config& config);
+
+size_t pgmoNumVertices(const MeshLod::Level& mesh);
+
+Eigen::Vector3f pgmoGetVertex(const MeshLod::Level& mesh,
+                              size_t i,
+                              kimera_pgmo::traits::VertexTraits* traits);
+
+size_t pgmoNumFaces(const MeshLod::Level& mesh);
+
+kimera_pgmo::traits::Face pgmoGetFace(const MeshLod::Level& mesh, size_t i);
+
+}  // namespace hydra
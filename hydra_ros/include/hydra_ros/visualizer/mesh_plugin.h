@@ -34,9 +34,15 @@
  * -------------------------------------------------------------------------- */
 #pragma once
 #include <config_utilities/factory.h>
+#include <geometry_msgs/PointStamped.h>
 #include <std_srvs/SetBool.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+
+#include <tuple>
 
 #include "hydra_ros/visualizer/dsg_visualizer_plugin.h"
+#include "hydra_ros/visualizer/mesh_lod.h"
 
 namespace hydra {
 
@@ -51,6 +57,11 @@ class MeshPlugin : public DsgVisualizerPlugin {
   struct Config {
     std::string label_colormap = "";
     bool color_by_label = false;
+    //! Publish a level-of-detail mesh instead of the full mesh
+    bool use_lod = false;
+    MeshLod::Config lod;
+    //! Initial viewpoint for the level of detail (updated via the lod_viewpoint topic)
+    std::vector<double> lod_viewpoint{0.0, 0.0, 0.0};
   } const config;
 
   MeshPlugin(const Config& config, const ros::NodeHandle& nh, const std::string& name);
@@ -70,6 +81,8 @@ class MeshPlugin : public DsgVisualizerPlugin {
  protected:
   bool handleService(std_srvs::SetBool::Request& req, std_srvs::SetBool::Response& res);
 
+  void handleViewpoint(const geometry_msgs::PointStamped& msg);
+
   std::string getMsgNamespace() const;
 
   bool color_by_label_ = false;
@@ -79,6 +92,20 @@ class MeshPlugin : public DsgVisualizerPlugin {
   std::unique_ptr<SemanticColorMap> colormap_;
   std::shared_ptr<const MeshColoring> mesh_coloring_;
 
+  using LodSource = std::tuple<const spark_dsg::Mesh*, size_t, size_t>;
+
+  std::unique_ptr<MeshLod> lod_;
+  LodSource lod_source_;
+  MeshLod::Level lod_mesh_;
+  Eigen::Vector3f viewpoint_;
+  //! Set when only the viewpoint changed and the cached blocks can be reused
+  bool viewpoint_changed_ = false;
+  ros::Subscriber viewpoint_sub_;
+  //! Frame the mesh was last drawn in (viewpoints are transformed into it)
+  std::string frame_id_;
+  std::unique_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::unique_ptr<tf2_ros::TransformListener> tf_listener_;
+
   inline static const auto registration_ =
       config::RegistrationWithConfig<DsgVisualizerPlugin,
                                      MeshPlugin,
@@ -45,6 +45,21 @@ using ColorFunction = std::function<Color(const SceneGraphNode&)>;
 using EdgeColorFunction = std::function<Color(
     const SceneGraphNode&, const SceneGraphNode&, const SceneGraphEdge&, bool)>;
 
+inline void hashCombine(size_t& seed, size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+inline size_t hashColor(const Color& color) {
+  return (static_cast<size_t>(color.r) << 24) | (static_cast<size_t>(color.g) << 16) |
+         (static_cast<size_t>(color.b) << 8) | static_cast<size_t>(color.a);
+}
+
+//! Hash of the node attributes that the layer markers depend on
+size_t hashNode(const SceneGraphNode& node);
+
+//! Hash of the nodes and edges of a layer that is independent of their ordering
+size_t hashLayerContents(const SceneGraphLayer& layer);
+
 Color getDistanceColor(const VisualizerConfig& config,
                            const ColormapConfig& colors,
                            double distance);
@@ -150,6 +165,38 @@ visualization_msgs::Marker makePlaceCentroidMarkers(
     const std::string& ns,
     const ColorFunction& color_func);
 
+//! Interlayer edge markers (one per source layer) that are kept between redraws
+struct EdgeMarkerBuffer {
+  struct Entry {
+    LayerId layer;
+    bool active = false;
+    size_t num_since_last_insertion = 0;
+    visualization_msgs::Marker marker;
+  };
+
+  //! Get the entry for a source layer, marking it active (and flagging first use)
+  Entry& entry(LayerId layer, bool& inserted);
+
+  //! Deactivate all entries while keeping their allocated storage
+  void clear();
+
+  //! Whether an active entry uses the provided namespace
+  bool contains(const std::string& ns) const;
+
+  //! Append all active markers to a message
+  void fill(visualization_msgs::MarkerArray& msg) const;
+
+  std::vector<Entry> entries;
+};
+
+void fillGraphEdgeMarkers(const std_msgs::Header& header,
+                          const DynamicSceneGraph& scene_graph,
+                          const std::map<LayerId, LayerConfig>& configs,
+                          const VisualizerConfig& visualizer_config,
+                          const std::string& ns,
+                          EdgeMarkerBuffer& buffer,
+                          const FilterFunction& filter = {});
+
 visualization_msgs::MarkerArray makeGraphEdgeMarkers(
     const std_msgs::Header& header,
     const DynamicSceneGraph& scene_graph,
@@ -228,6 +275,15 @@ visualization_msgs::Marker makeDynamicCentroidMarkers(
     const ColorFunction& color_func,
     size_t marker_id = 0);
 
+void fillDynamicGraphEdgeMarkers(
+    const std_msgs::Header& header,
+    const DynamicSceneGraph& graph,
+    const std::map<LayerId, LayerConfig>& configs,
+    const std::map<LayerId, DynamicLayerConfig>& dynamic_configs,
+    const VisualizerConfig& visualizer_config,
+    const std::string& ns_prefix,
+    EdgeMarkerBuffer& buffer);
+
 visualization_msgs::MarkerArray makeDynamicGraphEdgeMarkers(
     const std_msgs::Header& header,
     const DynamicSceneGraph& graph,
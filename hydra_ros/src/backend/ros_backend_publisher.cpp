@@ -34,20 +34,35 @@
  * -------------------------------------------------------------------------- */
 #include "hydra_ros/backend/ros_backend_publisher.h"
 
+#include <glog/logging.h>
 #include <hydra/common/global_info.h>
+#include <hydra/utils/timing_utilities.h>
 #include <kimera_pgmo_ros/visualization_functions.h>
 #include <pose_graph_tools_msgs/PoseGraph.h>
 #include <pose_graph_tools_ros/conversions.h>
 #include <visualization_msgs/Marker.h>
 
+#include <chrono>
+
 namespace hydra {
 
 using kimera_pgmo::DeformationGraph;
+using hydra_msgs::QueryFreespace;
 using kimera_pgmo::KimeraPgmoConfig;
 using kimera_pgmo_msgs::KimeraPgmoMesh;
 using pose_graph_tools_msgs::PoseGraph;
 using visualization_msgs::Marker;
 
+namespace {
+
+inline int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
 RosBackendPublisher::RosBackendPublisher(const ros::NodeHandle& nh) : nh_(nh) {
   mesh_mesh_edges_pub_ =
       nh_.advertise<Marker>("deformation_graph_mesh_mesh", 10, false);
@@ -59,14 +74,48 @@ RosBackendPublisher::RosBackendPublisher(const ros::NodeHandle& nh) : nh_(nh) {
   nh_.getParam("min_mesh_separation_s", separation);
   const auto map_frame = GlobalInfo::instance().getFrames().map;
   dsg_sender_.reset(new hydra::DsgSender(nh_, map_frame, "backend", false, separation));
+
+  bool serve_freespace_queries = false;
+  nh_.getParam("serve_freespace_queries", serve_freespace_queries);
+  if (serve_freespace_queries) {
+    double cell_size = 2.0;
+    nh_.getParam("freespace_index_cell_size", cell_size);
+    nh_.getParam("freespace_active_s", freespace_active_s_);
+    nh_.getParam("freespace_query_timeout_s", freespace_query_timeout_s_);
+    freespace_index_.reset(new FreespaceIndex(cell_size));
+    freespace_service_ = nh_.advertiseService(
+        "query_freespace", &RosBackendPublisher::handleFreespaceQuery, this);
+  }
+
+  bool publish_async = true;
+  nh_.getParam("publish_async", publish_async);
+  if (publish_async) {
+    worker_.reset(new SinkWorker("backend_publisher"));
+  }
 }
 
 void RosBackendPublisher::call(uint64_t timestamp_ns,
                                const DynamicSceneGraph& graph,
                                const DeformationGraph& dgraph) const {
+  // the backend holds its lock for the whole call
+  timing::ScopedTimer timer("backend/publisher_sink", timestamp_ns);
   ros::Time stamp;
   stamp.fromNSec(timestamp_ns);
-  dsg_sender_->sendGraph(graph, stamp);
+
+  // the index is synced from the live graph so it never requires a copy, and only
+  // while someone is querying it
+  if (freespace_index_ && freespaceQueriesActive()) {
+    updateFreespaceIndex(graph);
+  }
+
+  if (worker_ && dsg_sender_->hasSubscribers()) {
+    // only serialize while the graph is locked and send from the worker thread
+    auto msg = dsg_sender_->serializeUpdate(graph, stamp);
+    worker_->push([this, msg]() { dsg_sender_->sendSerialized(msg); });
+    dsg_sender_->sendMesh(graph, stamp);
+  } else {
+    dsg_sender_->sendGraph(graph, stamp);
+  }
 
   if (pose_graph_pub_.getNumSubscribers() > 0) {
     publishPoseGraph(graph, dgraph);
@@ -115,4 +164,61 @@ void RosBackendPublisher::publishDeformationGraphViz(const DeformationGraph& dgr
   }
 }
 
+void RosBackendPublisher::updateFreespaceIndex(const DynamicSceneGraph& graph) const {
+  if (!freespace_index_ || !graph.hasLayer(DsgLayers::PLACES)) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(freespace_mutex_);
+    const auto& places = graph.getLayer(DsgLayers::PLACES);
+    const auto num_changed = freespace_index_->update(places);
+    ++freespace_version_;
+    VLOG(5) << "[Hydra Backend] freespace index: " << num_changed << " / "
+            << freespace_index_->size() << " places changed";
+  }
+
+  freespace_cv_.notify_all();
+}
+
+bool RosBackendPublisher::freespaceQueriesActive() const {
+  const int64_t last_query_ns = last_query_ns_;
+  return last_query_ns > 0 && nowNs() - last_query_ns < freespace_active_s_ * 1.0e9;
+}
+
+bool RosBackendPublisher::handleFreespaceQuery(QueryFreespace::Request& req,
+                                               QueryFreespace::Response& res) {
+  if (req.x.size() != req.y.size() || req.x.size() != req.z.size()) {
+    ROS_ERROR_STREAM("Invalid freespace query: x, y and z sizes differ ("
+                     << req.x.size() << ", " << req.y.size() << ", " << req.z.size()
+                     << ")");
+    return false;
+  }
+
+  Eigen::Matrix3Xd points(3, req.x.size());
+  for (size_t i = 0; i < req.x.size(); ++i) {
+    points.col(i) << req.x[i], req.y[i], req.z[i];
+  }
+
+  const bool was_active = freespaceQueriesActive();
+  last_query_ns_ = nowNs();
+
+  std::unique_lock<std::mutex> lock(freespace_mutex_);
+  if (!was_active) {
+    // the index is not maintained while idle: wait for the next backend update
+    const auto version = freespace_version_;
+    const std::chrono::duration<double> timeout(freespace_query_timeout_s_);
+    if (!freespace_cv_.wait_for(
+            lock, timeout, [&]() { return freespace_version_ != version; })) {
+      ROS_WARN_STREAM("Freespace index was not refreshed within "
+                      << freespace_query_timeout_s_ << " s, answering from "
+                      << freespace_index_->size() << " places");
+    }
+  }
+
+  res.in_freespace =
+      freespace_index_->batchInFreespace(points, req.freespace_distance_m);
+  return true;
+}
+
 }  // namespace hydra
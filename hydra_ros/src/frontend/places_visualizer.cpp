@@ -69,9 +69,11 @@ void declare_config(PlacesVisualizer::Config& config) {
 PlacesVisualizer::PlacesVisualizer(const Config& config)
     : config_(config),
       nh_(config.ns),
-      previous_spheres_(0),
-      published_gvd_graph_(false) {
+      published_gvd_graph_(false),
+      gvd_cache_(new GvdMarkerCache()),
+      config_changed_(false) {
   pubs_.reset(new MarkerGroupPub(nh_));
+  esdf_grid_pub_ = nh_.advertise<nav_msgs::OccupancyGrid>("esdf_slice", 1, true);
   config_.graph.layer_z_step = 0;
 
   setupConfigServers();
@@ -95,6 +97,11 @@ void PlacesVisualizer::call(uint64_t timestamp_ns,
   header.frame_id = GlobalInfo::instance().getFrames().map;
   header.stamp.fromNSec(timestamp_ns);
 
+  if (config_changed_.exchange(false)) {
+    gvd_cache_->invalidate();
+    published_hashes_.clear();
+  }
+
   visualizeGvd(header, gvd);
 
   if (extractor) {
@@ -111,7 +118,6 @@ void PlacesVisualizer::call(uint64_t timestamp_ns,
     return;
   }
 
-  MarkerArray markers;
   pubs_->publish("gvd_cluster_viz", [&](MarkerArray& markers) {
     const std::string ns = "gvd_cluster_graph";
     if (compression->getGvdGraph().empty() && published_gvd_clusters_) {
@@ -157,6 +163,16 @@ void PlacesVisualizer::visualizeError(uint64_t timestamp_ns,
   });
 }
 
+bool PlacesVisualizer::hasChanged(const std::string& topic, size_t hash) const {
+  auto iter = published_hashes_.find(topic);
+  if (iter != published_hashes_.end() && iter->second == hash) {
+    return false;
+  }
+
+  published_hashes_[topic] = hash;
+  return true;
+}
+
 void PlacesVisualizer::visualizeGraph(const std_msgs::Header& header,
                                       const SceneGraphLayer& graph) const {
   if (graph.nodes().empty()) {
@@ -164,7 +180,21 @@ void PlacesVisualizer::visualizeGraph(const std_msgs::Header& header,
     return;
   }
 
+  const bool has_subscribers = pubs_->hasSubscribers("graph_viz") ||
+                               pubs_->hasSubscribers("freespace_viz") ||
+                               pubs_->hasSubscribers("freespace_graph_viz") ||
+                               pubs_->hasSubscribers("graph_label_viz");
+  if (!has_subscribers) {
+    return;
+  }
+
+  // markers of a topic are only rebuilt when the graph changed since it was published
+  const size_t graph_hash = hashLayerContents(graph);
   pubs_->publish("graph_viz", [&](MarkerArray& markers) {
+    if (!hasChanged("graph_viz", graph_hash)) {
+      return false;
+    }
+
     const std::string node_ns = config_.place_marker_ns + "_nodes";
     Marker node_marker = makeCentroidMarkers(
         header,
@@ -192,8 +222,8 @@ void PlacesVisualizer::visualizeGraph(const std_msgs::Header& header,
     return true;
   });
 
-  publishFreespace(header, graph);
-  publishGraphLabels(header, graph);
+  publishFreespace(header, graph, graph_hash);
+  publishGraphLabels(header, graph, graph_hash);
 }
 
 void PlacesVisualizer::visualizeGvdGraph(const std_msgs::Header& header,
@@ -222,7 +252,7 @@ void PlacesVisualizer::visualizeGvdGraph(const std_msgs::Header& header,
 void PlacesVisualizer::visualizeGvd(const std_msgs::Header& header,
                                     const GvdLayer& gvd) const {
   pubs_->publish("esdf_viz", [&](Marker& msg) {
-    msg = makeEsdfMarker(config_.gvd, config_.colormap, gvd);
+    fillEsdfMarker(config_.gvd, config_.colormap, gvd, msg);
     msg.header = header;
     msg.ns = "gvd_visualizer";
 
@@ -234,8 +264,15 @@ void PlacesVisualizer::visualizeGvd(const std_msgs::Header& header,
     }
   });
 
-  pubs_->publish("gvd_viz", [&](Marker& msg) {
-    msg = makeGvdMarker(config_.gvd, config_.colormap, gvd);
+  if (esdf_grid_pub_.getNumSubscribers()) {
+    nav_msgs::OccupancyGrid msg;
+    msg.header = header;
+    fillEsdfGrid(config_.gvd, gvd, msg);
+    esdf_grid_pub_.publish(msg);
+  }
+
+  const bool gvd_built = pubs_->publish("gvd_viz", [&](Marker& msg) {
+    gvd_cache_->fill(config_.gvd, config_.colormap, gvd, msg);
     msg.header = header;
     msg.ns = "gvd_visualizer";
 
@@ -247,6 +284,11 @@ void PlacesVisualizer::visualizeGvd(const std_msgs::Header& header,
     }
   });
 
+  if (!gvd_built) {
+    // without subscribers the builder is skipped, so blocks may change unseen
+    gvd_cache_->invalidate();
+  }
+
   pubs_->publish("surface_viz", [&](Marker& msg) {
     msg = makeSurfaceVoxelMarker(config_.gvd, config_.colormap, gvd);
     msg.header = header;
@@ -264,6 +306,19 @@ void PlacesVisualizer::visualizeGvd(const std_msgs::Header& header,
 void PlacesVisualizer::visualizeBlocks(const std_msgs::Header& header,
                                        const GvdLayer& gvd) const {
   pubs_->publish("voxel_block_viz", [&](Marker& msg) {
+    // the outlines only depend on which blocks are allocated
+    size_t hash = 0;
+    for (const auto& block : gvd) {
+      size_t block_hash = std::hash<int>()(block.index.x());
+      hashCombine(block_hash, std::hash<int>()(block.index.y()));
+      hashCombine(block_hash, std::hash<int>()(block.index.z()));
+      hash += block_hash;
+    }
+
+    if (!hasChanged("voxel_block_viz", hash)) {
+      return false;
+    }
+
     msg = makeBlocksMarker(gvd, config_.outline_scale);
     msg.header = header;
     msg.ns = "topology_server_blocks";
@@ -272,33 +327,48 @@ void PlacesVisualizer::visualizeBlocks(const std_msgs::Header& header,
 }
 
 void PlacesVisualizer::publishFreespace(const std_msgs::Header& header,
-                                        const SceneGraphLayer& graph) const {
-  const std::string label_ns = config_.place_marker_ns + "_freespace";
-
-  MarkerArray spheres = makePlaceSpheres(header, graph, label_ns, 0.15);
-
-  MarkerArray delete_markers;
-  for (size_t id = 0; id < previous_spheres_; ++id) {
-    Marker delete_label;
-    delete_label.action = Marker::DELETE;
-    delete_label.id = id;
-    delete_label.ns = label_ns;
-    delete_markers.markers.push_back(delete_label);
-  }
-  previous_spheres_ = spheres.markers.size();
-
-  // there's not really a clean way to delay computation on either of these markers, so
-  // we just assign the messages in the callbacks
+                                        const SceneGraphLayer& graph,
+                                        size_t graph_hash) const {
   pubs_->publish("freespace_viz", [&](MarkerArray& msg) {
-    msg = delete_markers;
-    return true;
-  });
-  pubs_->publish("freespace_viz", [&](MarkerArray& msg) {
-    msg = spheres;
-    return true;
+    // only changed spheres are sent, so new subscribers need every sphere once
+    const bool send_all = pubs_->checkNewSubscribers("freespace_viz");
+    if (!hasChanged("freespace_viz", graph_hash) && !send_all) {
+      return false;
+    }
+
+    const std::string ns = config_.place_marker_ns + "_freespace";
+    std::unordered_map<NodeId, size_t> spheres;
+    for (const auto& [node_id, node] : graph.nodes()) {
+      const auto& attrs = node->attributes<PlaceNodeAttributes>();
+      size_t sphere_hash = std::hash<double>()(attrs.distance);
+      for (int i = 0; i < 3; ++i) {
+        hashCombine(sphere_hash, std::hash<double>()(attrs.position(i)));
+      }
+
+      spheres.emplace(node_id, sphere_hash);
+      auto iter = published_spheres_.find(node_id);
+      if (send_all || iter == published_spheres_.end() ||
+          iter->second != sphere_hash) {
+        // adding an existing id replaces the previous sphere
+        msg.markers.push_back(makePlaceSphere(header, *node, ns, 0.15));
+      }
+    }
+
+    for (const auto& [node_id, sphere_hash] : published_spheres_) {
+      if (!spheres.count(node_id)) {
+        msg.markers.push_back(makeDeleteMarker(header, node_id, ns));
+      }
+    }
+
+    published_spheres_.swap(spheres);
+    return !msg.markers.empty();
   });
 
   pubs_->publish("freespace_graph_viz", [&](MarkerArray& markers) {
+    if (!hasChanged("freespace_graph_viz", graph_hash)) {
+      return false;
+    }
+
     const std::string node_ns = config_.place_marker_ns + "_freespace_nodes";
     auto freespace_conf = config_.graph_layer;
     freespace_conf.use_sphere_marker = false;
@@ -326,65 +396,56 @@ void PlacesVisualizer::publishFreespace(const std_msgs::Header& header,
 }
 
 void PlacesVisualizer::publishGraphLabels(const std_msgs::Header& header,
-                                          const SceneGraphLayer& graph) const {
+                                          const SceneGraphLayer& graph,
+                                          size_t graph_hash) const {
   if (!config_.graph_layer.use_label) {
     return;
   }
 
-  const std::string label_ns = config_.place_marker_ns + "_labels";
+  // stale labels are deleted in the same message that adds the current ones
+  pubs_->publish("graph_label_viz", [&](MarkerArray& msg) {
+    if (!hasChanged("graph_label_viz", graph_hash)) {
+      return false;
+    }
 
-  MarkerArray labels;
-  for (const auto& id_node_pair : graph.nodes()) {
-    const SceneGraphNode& node = *id_node_pair.second;
-    Marker label =
-        makeTextMarker(header, config_.graph_layer, node, config_.graph, label_ns);
-    labels.markers.push_back(label);
-  }
+    const std::string label_ns = config_.place_marker_ns + "_labels";
+    std::set<int> current_ids;
+    for (const auto& id_node_pair : graph.nodes()) {
+      const SceneGraphNode& node = *id_node_pair.second;
+      current_ids.insert(static_cast<int>(node.id));
+    }
 
-  std::set<int> current_ids;
-  for (const auto& label : labels.markers) {
-    current_ids.insert(label.id);
-  }
+    for (const auto previous : previous_labels_) {
+      if (!current_ids.count(previous)) {
+        msg.markers.push_back(makeDeleteMarker(header, previous, label_ns));
+      }
+    }
 
-  std::set<int> ids_to_delete;
-  for (auto previous : previous_labels_) {
-    if (!current_ids.count(previous)) {
-      ids_to_delete.insert(previous);
+    previous_labels_ = current_ids;
+    msg.markers.reserve(msg.markers.size() + graph.numNodes());
+    for (const auto& id_node_pair : graph.nodes()) {
+      const SceneGraphNode& node = *id_node_pair.second;
+      msg.markers.push_back(
+          makeTextMarker(header, config_.graph_layer, node, config_.graph, label_ns));
     }
-  }
-  previous_labels_ = current_ids;
-
-  MarkerArray delete_markers;
-  for (auto to_delete : ids_to_delete) {
-    Marker delete_label;
-    delete_label.action = Marker::DELETE;
-    delete_label.id = to_delete;
-    delete_label.ns = label_ns;
-    delete_markers.markers.push_back(delete_label);
-  }
 
-  // there's not really a clean way to delay computation on either of these markers, so
-  // we just assign the messages in the callbacks
-  pubs_->publish("graph_label_viz", [&](MarkerArray& msg) {
-    msg = delete_markers;
-    return true;
-  });
-  pubs_->publish("graph_label_viz", [&](MarkerArray& msg) {
-    msg = labels;
     return true;
   });
 }
 
 void PlacesVisualizer::graphConfigCb(LayerConfig& config, uint32_t) {
   config_.graph_layer = config;
+  config_changed_ = true;
 }
 
 void PlacesVisualizer::colormapCb(ColormapConfig& config, uint32_t) {
   config_.colormap = config;
+  config_changed_ = true;
 }
 
 void PlacesVisualizer::gvdConfigCb(GvdVisualizerConfig& config, uint32_t) {
   config_.gvd = config;
+  config_changed_ = true;
   config_.graph.places_colormap_min_distance = config.gvd_min_distance;
   config_.graph.places_colormap_max_distance = config.gvd_max_distance;
 }
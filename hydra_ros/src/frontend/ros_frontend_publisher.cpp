@@ -35,6 +35,7 @@
 #include "hydra_ros/frontend/ros_frontend_publisher.h"
 
 #include <hydra/common/global_info.h>
+#include <hydra/utils/timing_utilities.h>
 #include <kimera_pgmo_msgs/KimeraPgmoMeshDelta.h>
 #include <kimera_pgmo_ros/conversion/mesh_delta_conversion.h>
 #include <pose_graph_tools_msgs/PoseGraph.h>
@@ -51,11 +52,19 @@ RosFrontendPublisher::RosFrontendPublisher(const ros::NodeHandle& node_handle)
   dsg_sender_.reset(new DsgSender(nh_, odom_frame, "frontend", false));
   mesh_graph_pub_ = nh_.advertise<PoseGraph>("mesh_graph_incremental", 100, true);
   mesh_update_pub_ = nh_.advertise<KimeraPgmoMeshDelta>("full_mesh_update", 100, true);
+
+  bool publish_async = true;
+  nh_.getParam("publish_async", publish_async);
+  if (publish_async) {
+    worker_.reset(new SinkWorker("frontend_publisher"));
+  }
 }
 
 void RosFrontendPublisher::call(uint64_t timestamp_ns,
                                 const DynamicSceneGraph& graph,
                                 const BackendInput& backend_input) const {
+  // the frontend holds its lock for the whole call
+  timing::ScopedTimer timer("frontend/publisher_sink", timestamp_ns);
   if (backend_input.deformation_graph) {
     auto msg = pose_graph_tools::toMsg(*backend_input.deformation_graph);
     msg.header.stamp.fromNSec(timestamp_ns);
@@ -69,7 +78,15 @@ void RosFrontendPublisher::call(uint64_t timestamp_ns,
 
   ros::Time stamp;
   stamp.fromNSec(timestamp_ns);
-  dsg_sender_->sendGraph(graph, stamp);
+  if (!worker_ || !dsg_sender_->hasSubscribers()) {
+    dsg_sender_->sendGraph(graph, stamp);
+    return;
+  }
+
+  // only serialize while the graph is locked and send from the worker thread
+  auto msg = dsg_sender_->serializeUpdate(graph, stamp);
+  worker_->push([this, msg]() { dsg_sender_->sendSerialized(msg); });
+  dsg_sender_->sendMesh(graph, stamp);
 }
 
 }  // namespace hydra
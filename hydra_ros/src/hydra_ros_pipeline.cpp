@@ -105,8 +105,11 @@ void HydraRosPipeline::initBackend() {
   BackendModule::Ptr backend = config::createFromROS<BackendModule>(
       bnh, backend_dsg_, shared_state_, GlobalInfo::instance().getLogs());
   CHECK(backend) << "Failed to construct backend!";
-  backend->addSink(std::make_shared<RosBackendPublisher>(bnh));
+  backend_publisher_ = std::make_shared<RosBackendPublisher>(bnh);
+  backend->addSink(backend_publisher_);
   modules_["backend"] = backend;
+  get_dsg_service_ =
+      bnh.advertiseService("get_dsg", &HydraRosPipeline::handleGetDsg, this);
 
   const auto frontend = getModule<FrontendModule>("frontend");
   if (!frontend) {
@@ -155,4 +158,22 @@ void HydraRosPipeline::initLCD() {
   }
 }
 
+bool HydraRosPipeline::handleGetDsg(hydra_msgs::GetDsg::Request&,
+                                    hydra_msgs::GetDsg::Response& res) {
+  if (!backend_publisher_) {
+    return false;
+  }
+
+  // reuse the last broadcast serialization if the graph hasn't changed since
+  const auto& sender = backend_publisher_->getSender();
+  auto msg = sender.getCachedGraph();
+  if (!msg) {
+    std::unique_lock<std::mutex> lock(backend_dsg_->mutex);
+    msg = sender.cacheGraph(*backend_dsg_->graph, ros::Time::now());
+  }
+
+  res.graph = *msg;
+  return true;
+}
+
 }  // namespace hydra
@@ -0,0 +1,320 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <glog/logging.h>
+#include <hydra_msgs/GetDsg.h>
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hydra_ros/utils/dsg_streaming_interface.h"
+#include "hydra_ros/visualizer/visualizer_utilities.h"
+
+namespace hydra {
+
+struct DsgAggregatorNode {
+  using Edge = std::pair<NodeId, NodeId>;
+
+  struct EdgeHash {
+    size_t operator()(const Edge& edge) const {
+      return std::hash<NodeId>()(edge.first) * 31 + std::hash<NodeId>()(edge.second);
+    }
+  };
+
+  using NodeHashes = std::unordered_map<NodeId, size_t>;
+  using EdgeHashes = std::unordered_map<Edge, size_t, EdgeHash>;
+
+  struct RobotInfo {
+    std::string ns;
+    std::unique_ptr<DsgReceiver> receiver;
+    // hashes of the static layer nodes and edges the robot contributed to the merged
+    // graph, used to only send what changed since its last merge (see hashNode() for
+    // the attributes that count as a change)
+    NodeHashes nodes;
+    EdgeHashes edges;
+    std::optional<int64_t> last_sequence_number;
+    size_t num_merges = 0;
+  };
+
+  //! Changes to the merged graph since the last publish
+  struct Changes {
+    DynamicSceneGraph::Ptr delta;
+    std::vector<NodeId> deleted_nodes;
+    std::vector<Edge> deleted_edges;
+  };
+
+  DsgAggregatorNode(const ros::NodeHandle& nh)
+      : nh_(nh), frame_id_("map"), publish_rate_hz_(1.0) {
+    std::vector<std::string> robot_namespaces;
+    if (!nh_.getParam("robots", robot_namespaces) || robot_namespaces.empty()) {
+      ROS_FATAL("Failed to get robot namespaces parameter");
+      throw std::runtime_error("failed to get robot namespaces");
+    }
+
+    nh_.getParam("frame_id", frame_id_);
+    nh_.getParam("publish_rate_hz", publish_rate_hz_);
+
+    for (const auto& ns : robot_namespaces) {
+      auto& robot = robots_.emplace_back();
+      robot.ns = ns;
+      robot.receiver.reset(new DsgReceiver(ros::NodeHandle(nh_, ns)));
+    }
+
+    // only the merged graph is sent: robot meshes are not combined
+    sender_.reset(new DsgSender(nh_, frame_id_, "aggregator", false, 0.0, false));
+    // receivers that join late or miss an update request the full merged graph
+    get_dsg_service_ =
+        nh_.advertiseService("get_dsg", &DsgAggregatorNode::handleGetDsg, this);
+  }
+
+  bool handleGetDsg(hydra_msgs::GetDsg::Request&, hydra_msgs::GetDsg::Response& res) {
+    if (!merged_) {
+      return false;
+    }
+
+    res.graph = *sender_->cacheGraph(*merged_, ros::Time::now());
+    return true;
+  }
+
+  void spin() {
+    ros::WallRate r(publish_rate_hz_);
+    while (ros::ok()) {
+      ros::spinOnce();
+
+      // receivers apply every update as it arrives, so updates that arrive between
+      // publishes are coalesced into a single merge per robot
+      Changes changes;
+      for (size_t i = 0; i < robots_.size(); ++i) {
+        auto& robot = robots_[i];
+        if (!robot.receiver->consumeUpdate() || !robot.receiver->graph()) {
+          continue;
+        }
+
+        mergeRobot(i, changes);
+      }
+
+      if (changes.delta) {
+        // another robot may have claimed what a robot removed in the same cycle
+        auto& nodes = changes.deleted_nodes;
+        nodes.erase(std::remove_if(nodes.begin(),
+                                   nodes.end(),
+                                   [&](NodeId node_id) {
+                                     return changes.delta->hasNode(node_id);
+                                   }),
+                    nodes.end());
+        auto& edges = changes.deleted_edges;
+        edges.erase(std::remove_if(edges.begin(),
+                                   edges.end(),
+                                   [&](const Edge& edge) {
+                                     return changes.delta->hasEdge(edge.first,
+                                                                   edge.second);
+                                   }),
+                    edges.end());
+
+        sender_->sendUpdate(*merged_,
+                            *changes.delta,
+                            changes.deleted_nodes,
+                            changes.deleted_edges,
+                            ros::Time::now());
+      }
+
+      r.sleep();
+    }
+  }
+
+  void mergeRobot(size_t robot_index, Changes& changes) {
+    auto& robot = robots_[robot_index];
+    // hold onto the graph so the receiver can't reuse it while we merge
+    const auto graph_ptr = robot.receiver->graph();
+    const auto& graph = *graph_ptr;
+
+    const auto sequence_number = robot.receiver->sequenceNumber();
+    if (robot.last_sequence_number && sequence_number &&
+        *sequence_number < *robot.last_sequence_number) {
+      ROS_WARN_STREAM("Sequence for " << robot.ns << " went from "
+                                      << *robot.last_sequence_number << " to "
+                                      << *sequence_number << ": robot restarted?");
+    }
+
+    robot.last_sequence_number = sequence_number;
+
+    if (!merged_) {
+      merged_ = std::make_shared<DynamicSceneGraph>(graph.layer_ids);
+    }
+
+    if (!changes.delta) {
+      changes.delta = std::make_shared<DynamicSceneGraph>(merged_->layer_ids);
+    }
+
+    // nodes are keyed by the robot that provided them first: a robot reusing another
+    // robot's node ids (i.e., the same node prefix) is rejected instead of merged
+    NodeHashes current;
+    std::unordered_set<NodeId> rejected;
+    std::unordered_set<NodeId> changed;
+    current.reserve(robot.nodes.size());
+    for (const auto layer_id : graph.layer_ids) {
+      for (const auto& [node_id, node] : graph.getLayer(layer_id).nodes()) {
+        const auto iter = owners_.find(node_id);
+        if (iter == owners_.end()) {
+          owners_.emplace(node_id, robot_index);
+        } else if (iter->second != robot_index) {
+          rejected.insert(node_id);
+          continue;
+        }
+
+        const auto node_hash = hashNode(*node);
+        current.emplace(node_id, node_hash);
+        const auto prev = robot.nodes.find(node_id);
+        if (prev == robot.nodes.end() || prev->second != node_hash) {
+          changed.insert(node_id);
+        }
+      }
+    }
+
+    if (!rejected.empty()) {
+      const auto example = *rejected.begin();
+      ROS_WARN_STREAM_THROTTLE(5.0,
+                               "Rejected "
+                                   << rejected.size() << " node(s) from " << robot.ns
+                                   << " (e.g., " << NodeSymbol(example).getLabel()
+                                   << ") already provided by "
+                                   << robots_[owners_.at(example)].ns
+                                   << ": robots should use distinct node prefixes");
+    }
+
+    // new or changed edges need both of their nodes in the delta
+    EdgeHashes edges;
+    edges.reserve(robot.edges.size());
+    const auto add_edge = [&](const SceneGraphEdge& edge) {
+      if (rejected.count(edge.source) || rejected.count(edge.target)) {
+        return;
+      }
+
+      const Edge key(edge.source, edge.target);
+      const auto edge_hash = std::hash<double>()(edge.attributes().weight);
+      edges.emplace(key, edge_hash);
+      const auto prev = robot.edges.find(key);
+      if (prev == robot.edges.end() || prev->second != edge_hash) {
+        changed.insert(edge.source);
+        changed.insert(edge.target);
+      }
+    };
+
+    for (const auto layer_id : graph.layer_ids) {
+      for (const auto& id_edge_pair : graph.getLayer(layer_id).edges()) {
+        add_edge(id_edge_pair.second);
+      }
+    }
+
+    for (const auto& id_edge_pair : graph.interlayer_edges()) {
+      add_edge(id_edge_pair.second);
+    }
+
+    // the delta keeps the dynamic layers whole (their nodes are indexed by position)
+    // and only the static layer nodes that are new or changed
+    auto delta = graph.clone();
+    for (const auto layer_id : graph.layer_ids) {
+      for (const auto& id_node_pair : graph.getLayer(layer_id).nodes()) {
+        if (!changed.count(id_node_pair.first)) {
+          delta->removeNode(id_node_pair.first);
+        }
+      }
+    }
+
+    // everything else is already in the merged graph
+    merged_->mergeGraph(*delta);
+    changes.delta->mergeGraph(*delta);
+
+    // propagate edge deletions that a full update only conveys by omission
+    for (const auto& [edge, edge_hash] : robot.edges) {
+      if (edges.count(edge) || !merged_->hasEdge(edge.first, edge.second)) {
+        continue;
+      }
+
+      merged_->removeEdge(edge.first, edge.second);
+      changes.deleted_edges.push_back(edge);
+    }
+
+    robot.edges = std::move(edges);
+
+    // same for nodes
+    for (const auto& [node_id, node_hash] : robot.nodes) {
+      if (current.count(node_id)) {
+        continue;
+      }
+
+      const auto iter = owners_.find(node_id);
+      if (iter == owners_.end() || iter->second != robot_index) {
+        continue;
+      }
+
+      owners_.erase(iter);
+      if (merged_->hasNode(node_id)) {
+        merged_->removeNode(node_id);
+        changes.deleted_nodes.push_back(node_id);
+      }
+    }
+
+    robot.nodes = std::move(current);
+    ++robot.num_merges;
+    VLOG(2) << "[DSG Aggregator] merged update " << sequence_number.value_or(-1)
+            << " from " << robot.ns << " (" << changed.size() << " / "
+            << robot.nodes.size() << " nodes changed, " << robot.num_merges
+            << " merges)";
+  }
+
+  ros::NodeHandle nh_;
+  std::string frame_id_;
+  double publish_rate_hz_;
+
+  std::vector<RobotInfo> robots_;
+  std::unordered_map<NodeId, size_t> owners_;
+  DynamicSceneGraph::Ptr merged_;
+  std::unique_ptr<DsgSender> sender_;
+  ros::ServiceServer get_dsg_service_;
+};
+
+}  // namespace hydra
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "dsg_aggregator_node");
+
+  ros::NodeHandle nh("~");
+  hydra::DsgAggregatorNode node(nh);
+  node.spin();
+
+  return 0;
+}
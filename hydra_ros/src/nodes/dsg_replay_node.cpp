@@ -0,0 +1,182 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <hydra_msgs/DsgUpdate.h>
+#include <ros/ros.h>
+#include <std_msgs/Float64.h>
+
+#include <algorithm>
+
+#include "hydra_ros/utils/dsg_log.h"
+
+namespace hydra {
+
+struct DsgReplayNode {
+  DsgReplayNode(const ros::NodeHandle& nh)
+      : nh_(nh), frame_id_("map"), rate_(1.0), start_time_s_(0.0), loop_(false) {
+    if (!nh_.getParam("log_path", log_path_)) {
+      ROS_FATAL("Failed to get log path parameter");
+      throw std::runtime_error("failed to get log path");
+    }
+
+    nh_.getParam("frame_id", frame_id_);
+    // playback speed relative to the recording, non-positive values replay the log
+    // as fast as possible
+    nh_.getParam("rate", rate_);
+    nh_.getParam("start_time", start_time_s_);
+    nh_.getParam("loop", loop_);
+
+    reader_.reset(new DsgLogReader(log_path_));
+    if (!reader_->valid() || !reader_->startTime()) {
+      ROS_FATAL_STREAM("Log " << log_path_ << " contains no graphs");
+      throw std::runtime_error("invalid log");
+    }
+
+    ROS_INFO_STREAM("Loaded " << reader_->keyframes().size() << " keyframes spanning "
+                              << (*reader_->endTime() - *reader_->startTime()) * 1.0e-9
+                              << " [s] from " << log_path_);
+
+    pub_ = nh_.advertise<hydra_msgs::DsgUpdate>("dsg", 1, true);
+    seek_sub_ = nh_.subscribe("seek", 1, &DsgReplayNode::handleSeek, this);
+  }
+
+  void handleSeek(const std_msgs::Float64& msg) { seekTo(msg.data); }
+
+  //! Jump to the state of the graph at some time relative to the start of the log
+  void seekTo(double time_s) {
+    const uint64_t offset_ns = time_s > 0.0 ? time_s * 1.0e9 : 0;
+    target_ns_ = *reader_->startTime() + offset_ns;
+    reader_->seek(target_ns_);
+    wall_start_ = ros::WallTime::now();
+    ++num_seeks_;
+    ROS_INFO_STREAM("Replaying from " << time_s << " [s]");
+  }
+
+  void spin() {
+    seekTo(start_time_s_);
+
+    DsgLogRecord record;
+    size_t finished_seeks = 0;
+    while (ros::ok()) {
+      ros::spinOnce();
+      if (finished_seeks == num_seeks_) {
+        // the last graph stays latched until a seek restarts the replay
+        ros::WallDuration(0.05).sleep();
+        continue;
+      }
+
+      if (!reader_->next(record)) {
+        if (loop_) {
+          seekTo(0.0);
+          continue;
+        }
+
+        ROS_INFO_STREAM("Finished replaying " << log_path_ << ", waiting for a seek");
+        finished_seeks = num_seeks_;
+        continue;
+      }
+
+      if (!waitFor(record.stamp_ns)) {
+        continue;  // seek requested while waiting
+      }
+
+      publish(record);
+    }
+  }
+
+  bool waitFor(uint64_t stamp_ns) {
+    // records before the seek target restore state and are sent immediately
+    if (rate_ <= 0.0 || stamp_ns <= target_ns_) {
+      return true;
+    }
+
+    const auto num_seeks = num_seeks_;
+    const ros::WallTime deadline =
+        wall_start_ + ros::WallDuration((stamp_ns - target_ns_) * 1.0e-9 / rate_);
+    while (ros::ok()) {
+      const auto now = ros::WallTime::now();
+      if (now >= deadline) {
+        return true;
+      }
+
+      // sleep in short intervals to stay responsive to seeks
+      std::min(deadline - now, ros::WallDuration(0.05)).sleep();
+      ros::spinOnce();
+      if (num_seeks_ != num_seeks) {
+        return false;
+      }
+    }
+
+    return false;
+  }
+
+  void publish(DsgLogRecord& record) {
+    hydra_msgs::DsgUpdate::Ptr msg(new hydra_msgs::DsgUpdate());
+    msg->header.stamp.fromNSec(record.stamp_ns);
+    msg->header.frame_id = frame_id_;
+    msg->full_update = record.full_update;
+    msg->sequence_number = record.sequence_number;
+    msg->layer_contents = std::move(record.contents);
+    msg->deleted_nodes = std::move(record.deleted_nodes);
+    msg->deleted_edges = std::move(record.deleted_edges);
+    pub_.publish(msg);
+  }
+
+  ros::NodeHandle nh_;
+  std::string log_path_;
+  std::string frame_id_;
+  double rate_;
+  double start_time_s_;
+  bool loop_;
+
+  std::unique_ptr<DsgLogReader> reader_;
+  uint64_t target_ns_ = 0;
+  ros::WallTime wall_start_;
+  size_t num_seeks_ = 0;
+
+  ros::Publisher pub_;
+  ros::Subscriber seek_sub_;
+};
+
+}  // namespace hydra
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "dsg_replay_node");
+
+  ros::NodeHandle nh("~");
+  hydra::DsgReplayNode node(nh);
+  node.spin();
+
+  return 0;
+}
@@ -40,6 +40,7 @@
 
 #include "hydra_ros/hydra_ros_pipeline.h"
 #include "hydra_ros/utils/node_utilities.h"
+#include "hydra_ros/visualizer/gvd_visualization_utilities.h"
 
 int main(int argc, char* argv[]) {
   ros::init(argc, argv, "hydra_node");
@@ -63,6 +64,7 @@ int main(int argc, char* argv[]) {
   hydra.start();
   hydra::spinAndWait(nh);
   hydra.stop();
+  LOG(INFO) << hydra::MarkerGroupPub::skippedWorkReport();
   hydra.save();
   hydra::GlobalInfo::exit();
 
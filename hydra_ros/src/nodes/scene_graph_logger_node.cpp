@@ -34,46 +34,252 @@
  * -------------------------------------------------------------------------- */
 #include <ros/ros.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <filesystem>
 #include <iomanip>
 
+#include "hydra_ros/utils/dsg_log.h"
 #include "hydra_ros/utils/dsg_streaming_interface.h"
+#include "hydra_ros/utils/sink_worker.h"
 
 namespace hydra {
 
 struct SceneGraphLoggerNode {
   SceneGraphLoggerNode(const ros::NodeHandle& nh)
-      : nh_(nh), curr_count_(0), curr_output_count_(0), output_every_num_(1) {
-    receiver_.reset(new DsgReceiver(nh_));
+      : nh_(nh),
+        curr_count_(0),
+        curr_output_count_(0),
+        output_every_num_(1),
+        output_format_("json"),
+        max_disk_mb_(0.0),
+        log_updates_(false),
+        max_pending_updates_(100),
+        disk_usage_(0) {
     if (!nh_.getParam("output_path", output_path_)) {
       ROS_FATAL("Failed to get output path parameter");
       throw std::runtime_error("failed to get output path");
     }
 
     nh_.getParam("output_every_num", output_every_num_);
+    output_every_num_ = std::max(output_every_num_, 1);
+    // "json" or "binary"
+    nh_.getParam("output_format", output_format_);
+    if (output_format_ != "json" && output_format_ != "binary") {
+      ROS_FATAL_STREAM("Invalid output format: " << output_format_);
+      throw std::runtime_error("invalid output format");
+    }
+
+    // oldest graphs or log segments are removed once the output exceeds this
+    // (0 disables)
+    nh_.getParam("max_disk_mb", max_disk_mb_);
+
+    int max_pending_writes = 2;
+    nh_.getParam("max_pending_writes", max_pending_writes);
+    max_pending_writes = std::max(max_pending_writes, 1);
+
+    // record every update to a binary log (for dsg_replay_node) instead of saving
+    // individual graphs
+    nh_.getParam("log_updates", log_updates_);
+    if (log_updates_) {
+      // the writer never drops updates itself: once too many are pending, updates
+      // are skipped until the next full update so the log stays consistent
+      nh_.getParam("max_pending_updates", max_pending_updates_);
+      max_pending_updates_ = std::max(max_pending_updates_, 1);
+      update_sub_ = nh_.subscribe("dsg", 10, &SceneGraphLoggerNode::handleUpdate, this);
+      max_pending_writes = 0;
+    } else {
+      receiver_.reset(new DsgReceiver(nh_));
+    }
+
+    writer_.reset(new SinkWorker("scene_graph_logger", max_pending_writes));
+  }
+
+  ~SceneGraphLoggerNode() {
+    // finish pending writes before closing the log
+    writer_.reset();
+  }
+
+  void handleUpdate(const hydra_msgs::DsgUpdate::ConstPtr& msg) {
+    if (wait_for_full_update_ && !msg->full_update) {
+      // incremental updates are useless without the graph they apply to
+      ++num_skipped_;
+      return;
+    }
+
+    if (num_pending_ >= static_cast<size_t>(max_pending_updates_)) {
+      wait_for_full_update_ = true;
+      ++num_skipped_;
+      ROS_WARN_STREAM_THROTTLE(5.0,
+                               "Log writer is falling behind: skipped "
+                                   << num_skipped_ << " updates so far");
+      return;
+    }
+
+    wait_for_full_update_ = false;
+    ++num_pending_;
+    // updates are written as received, without deserializing them
+    writer_->push([this, msg]() {
+      --num_pending_;
+      logUpdate(*msg);
+    });
+  }
+
+  void logUpdate(const hydra_msgs::DsgUpdate& msg) {
+    // runs on the writer thread. with a disk budget, the log is split into segments
+    // that each start with a full update so the oldest ones can be dropped
+    const size_t max_bytes = max_disk_mb_ * 1024 * 1024;
+    if (msg.full_update && (!log_ || (max_bytes && log_->size() >= max_bytes / 4))) {
+      openLogSegment();
+    }
+
+    if (!log_) {
+      return;  // segments only ever start with a full update
+    }
+
+    const auto& contents = msg.layer_contents;
+    if (log_->write(msg.header.stamp.toNSec(),
+                    msg.sequence_number,
+                    msg.full_update,
+                    contents.data(),
+                    contents.size(),
+                    msg.deleted_nodes,
+                    msg.deleted_edges)) {
+      ++num_logged_;
+    }
+
+    rotate(log_->size());
+  }
+
+  void openLogSegment() {
+    if (log_) {
+      log_->flush();
+      const auto path = log_->path();
+      const auto index_path = DsgLogWriter::indexPath(path);
+      std::error_code ec;
+      const auto index_size = std::filesystem::file_size(index_path, ec);
+      const size_t size = log_->size() + (ec ? 0 : index_size);
+      log_.reset();
+      saved_.push_back({path, size});
+      disk_usage_ += size;
+    }
+
+    std::string name = "dsg.log";
+    if (max_disk_mb_ > 0.0) {
+      std::stringstream ss;
+      ss << "dsg_" << std::setfill('0') << std::setw(6) << curr_output_count_ << ".log";
+      ++curr_output_count_;
+      name = ss.str();
+    }
+
+    const auto path = std::filesystem::path(output_path_) / name;
+    log_.reset(new DsgLogWriter(path.string()));
   }
 
   void spin() {
+    if (log_updates_) {
+      ros::spin();
+      writer_->flush();
+      ROS_INFO_STREAM("Wrote " << num_logged_ << " updates to " << output_path_
+                                << " (skipped " << num_skipped_ << ")");
+      return;
+    }
+
     ros::WallRate r(10);
     while (ros::ok()) {
       ros::spinOnce();
 
-      if (!receiver_->updated()) {
+      if (!receiver_->consumeUpdate()) {
         r.sleep();
         continue;
       }
 
-      receiver_->clearUpdated();
       ++curr_count_;
-      if (output_every_num_ == 1 || curr_count_ % output_every_num_ != 1) {
+      // save the first update and every output_every_num-th update after it
+      if ((curr_count_ - 1) % output_every_num_ != 0) {
         continue;
       }
 
-      std::stringstream ss;
-      ss << output_path_ << "/dsg_" << std::setfill('0') << std::setw(6)
-         << curr_output_count_;
-      ss << ".json";
-      receiver_->graph()->save(ss.str(), false);
-      ++curr_output_count_;
+      // the receiver never modifies a graph that is still referenced, so holding
+      // the pointer is enough to snapshot it
+      auto graph = receiver_->graph();
+      if (!graph) {
+        continue;
+      }
+
+      const auto filepath = nextFilepath();
+      writer_->push([this, graph, filepath]() { save(*graph, filepath); });
+    }
+
+    writer_->flush();
+  }
+
+  std::filesystem::path nextFilepath() {
+    std::stringstream ss;
+    ss << "dsg_" << std::setfill('0') << std::setw(6) << curr_output_count_;
+    ss << (output_format_ == "binary" ? ".sparkdsg" : ".json");
+    ++curr_output_count_;
+    return std::filesystem::path(output_path_) / ss.str();
+  }
+
+  void save(const DynamicSceneGraph& graph, const std::filesystem::path& filepath) {
+    // runs on the writer thread
+    const auto num_dropped = writer_->numDropped();
+    if (num_dropped > num_dropped_) {
+      ROS_WARN_STREAM("Writer is falling behind: dropped " << num_dropped
+                                                           << " graphs so far");
+      num_dropped_ = num_dropped;
+    }
+
+    try {
+      graph.save(filepath, false);
+    } catch (const std::exception& e) {
+      ROS_ERROR_STREAM("Failed to save " << filepath << ": " << e.what());
+      return;
+    }
+
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(filepath, ec);
+    if (ec) {
+      return;
+    }
+
+    saved_.push_back({filepath, size});
+    disk_usage_ += size;
+    rotate();
+  }
+
+  /**
+   * @brief Remove the oldest outputs until the disk budget is met
+   * @param active_bytes Size of the log segment that is still being written
+   */
+  void rotate(size_t active_bytes = 0) {
+    const size_t max_bytes = max_disk_mb_ * 1024 * 1024;
+    if (max_bytes == 0) {
+      return;
+    }
+
+    // always keep the latest graph (or the active log segment), even if it is over
+    // budget on its own
+    const size_t num_kept = active_bytes ? 0 : 1;
+    while (disk_usage_ + active_bytes > max_bytes && saved_.size() > num_kept) {
+      const auto& [oldest, size] = saved_.front();
+      remove(oldest);
+      if (oldest.extension() == ".log") {
+        remove(DsgLogWriter::indexPath(oldest.string()));
+      }
+
+      disk_usage_ -= size;
+      saved_.pop_front();
+    }
+  }
+
+  void remove(const std::filesystem::path& path) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if (ec) {
+      ROS_WARN_STREAM("Failed to remove " << path << ": " << ec.message());
     }
   }
 
@@ -82,7 +288,26 @@ struct SceneGraphLoggerNode {
   size_t curr_output_count_;
   int output_every_num_;
   std::string output_path_;
+  std::string output_format_;
+  double max_disk_mb_;
+  bool log_updates_;
+  int max_pending_updates_;
   std::unique_ptr<DsgReceiver> receiver_;
+  std::unique_ptr<DsgLogWriter> log_;
+  ros::Subscriber update_sub_;
+
+  // only accessed by the subscriber thread (besides the count of queued updates)
+  bool wait_for_full_update_ = true;
+  size_t num_skipped_ = 0;
+  std::atomic<size_t> num_pending_{0};
+
+  // only accessed by the writer thread
+  std::deque<std::pair<std::filesystem::path, size_t>> saved_;
+  size_t disk_usage_;
+  size_t num_dropped_ = 0;
+  size_t num_logged_ = 0;
+
+  std::unique_ptr<SinkWorker> writer_;
 };
 
 }  // namespace hydra
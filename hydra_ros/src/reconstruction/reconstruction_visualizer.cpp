@@ -40,6 +40,9 @@
 #include <hydra/common/global_info.h>
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <unordered_map>
+
+#include "hydra_ros/utils/index_hash.h"
 #include "hydra_ros/visualizer/colormap_utilities.h"
 #include "hydra_ros/visualizer/gvd_visualization_utilities.h"
 
@@ -47,11 +50,9 @@ namespace hydra {
 
 using visualization_msgs::Marker;
 using visualization_msgs::MarkerArray;
+using spatial_hash::BlockIndex;
 using VizConfig = ReconstructionVisualizer::Config;
 
-using ColorFunction =
-    std::function<std_msgs::ColorRGBA(const VizConfig&, const TsdfVoxel&)>;
-
 std_msgs::ColorRGBA colorVoxelByDist(const VizConfig& config, const TsdfVoxel& voxel) {
   double ratio =
       dsg_utils::computeRatio(config.min_distance, config.max_distance, voxel.distance);
@@ -68,14 +69,69 @@ std_msgs::ColorRGBA colorVoxelByWeight(const VizConfig& config,
   return dsg_utils::makeColorMsg(color, config.marker_alpha);
 }
 
+//! Observed voxels of a single block at the slice height with both colorings
+struct BlockSlice {
+  std::vector<geometry_msgs::Point> points;
+  std::vector<float> distances;
+  std::vector<float> weights;
+  std::vector<std_msgs::ColorRGBA> distance_colors;
+  std::vector<std_msgs::ColorRGBA> weight_colors;
+};
+
+struct ReconstructionVisualizer::SliceCache {
+  //! Whether the cached slices are still consistent with the layer
+  bool valid = false;
+  //! Block z index and voxel z index of the cached slice
+  int block_z = 0;
+  size_t voxel_z = 0;
+  bool has_distance = false;
+  bool has_weight = false;
+  std::unordered_map<BlockIndex, BlockSlice, IndexHash> blocks;
+};
+
+namespace {
+
 // adapted from khronos
-Marker makeTsdfMarker(const VizConfig& config,
-                      const std_msgs::Header& header,
-                      const TsdfLayer& layer,
-                      const Eigen::Isometry3d& world_T_sensor,
-                      const ColorFunction& color_func,
-                      const std::string& ns) {
-  Marker msg;
+void fillBlockSlice(const VizConfig& config,
+                    const TsdfBlock& block,
+                    size_t voxel_z,
+                    bool use_distance,
+                    bool use_weight,
+                    BlockSlice& slice) {
+  slice.points.clear();
+  slice.distances.clear();
+  slice.weights.clear();
+  slice.distance_colors.clear();
+  slice.weight_colors.clear();
+  for (size_t x = 0; x < block.voxels_per_side; ++x) {
+    for (size_t y = 0; y < block.voxels_per_side; ++y) {
+      const VoxelIndex voxel_index(x, y, voxel_z);
+      const auto& voxel = block.getVoxel(voxel_index);
+      if (voxel.weight < config.min_observation_weight) {
+        continue;
+      }
+
+      const Eigen::Vector3d pos = block.getVoxelPosition(voxel_index).cast<double>();
+      tf2::convert(pos, slice.points.emplace_back());
+      slice.distances.push_back(voxel.distance);
+      slice.weights.push_back(voxel.weight);
+      if (use_distance) {
+        slice.distance_colors.push_back(colorVoxelByDist(config, voxel));
+      }
+
+      if (use_weight) {
+        slice.weight_colors.push_back(colorVoxelByWeight(config, voxel));
+      }
+    }
+  }
+}
+
+void fillTsdfMarker(const std_msgs::Header& header,
+                    const TsdfLayer& layer,
+                    const ReconstructionVisualizer::SliceCache& cache,
+                    bool use_distance,
+                    const std::string& ns,
+                    Marker& msg) {
   msg.header = header;
   msg.action = visualization_msgs::Marker::ADD;
   msg.id = 0;
@@ -89,44 +145,58 @@ Marker makeTsdfMarker(const VizConfig& config,
   tf2::convert(identity_pos, msg.pose.position);
   tf2::convert(Eigen::Quaterniond::Identity(), msg.pose.orientation);
 
-  auto height = config.slice_height;
-  if (config.use_relative_height) {
-    height += world_T_sensor.translation().z();
+  size_t num_points = 0;
+  for (const auto& [index, slice] : cache.blocks) {
+    num_points += slice.points.size();
   }
 
-  const Point slice_pos(0, 0, height);
-  const auto slice_index = layer.getBlockIndex(slice_pos);
-  const auto origin =
-      spatial_hash::originPointFromIndex(slice_index, layer.blockSize());
-  const auto grid_index = spatial_hash::indexFromPoint<VoxelIndex>(
-      slice_pos - origin, layer.voxel_size_inv);
+  msg.points.clear();
+  msg.colors.clear();
+  msg.points.reserve(num_points);
+  msg.colors.reserve(num_points);
+  for (const auto& [index, slice] : cache.blocks) {
+    const auto& colors = use_distance ? slice.distance_colors : slice.weight_colors;
+    msg.points.insert(msg.points.end(), slice.points.begin(), slice.points.end());
+    msg.colors.insert(msg.colors.end(), colors.begin(), colors.end());
+  }
+}
 
-  for (const auto& block : layer) {
-    if (block.index.z() != slice_index.z()) {
-      continue;
-    }
+void fillTsdfGrid(const VizConfig& config,
+                  const std_msgs::Header& header,
+                  const TsdfLayer& layer,
+                  const ReconstructionVisualizer::SliceCache& cache,
+                  bool use_distance,
+                  nav_msgs::OccupancyGrid& msg) {
+  msg.header = header;
+  Eigen::AlignedBox2f extent;
+  for (const auto& [index, slice] : cache.blocks) {
+    const Eigen::Vector2f origin = index.head<2>().cast<float>() * layer.blockSize();
+    extent.extend(origin);
+    extent.extend((origin.array() + layer.blockSize()).matrix());
+  }
 
-    for (size_t x = 0; x < block.voxels_per_side; ++x) {
-      for (size_t y = 0; y < block.voxels_per_side; ++y) {
-        const VoxelIndex voxel_index(x, y, grid_index.z());
-        const auto& voxel = block.getVoxel(voxel_index);
-        if (voxel.weight < config.min_observation_weight) {
-          continue;
-        }
-
-        const Eigen::Vector3d pos =
-            block.getVoxelPosition(voxel_index).cast<double>();
-        geometry_msgs::Point marker_pos;
-        tf2::convert(pos, marker_pos);
-        msg.points.push_back(marker_pos);
-        msg.colors.push_back(color_func(config, voxel));
+  const double height =
+      (cache.block_z * layer.voxels_per_side + cache.voxel_z + 0.5) * layer.voxel_size;
+  resetSliceGrid(layer.voxel_size, height, extent, msg);
+  for (const auto& [index, slice] : cache.blocks) {
+    for (size_t i = 0; i < slice.points.size(); ++i) {
+      const auto& point = slice.points[i];
+      double ratio;
+      if (use_distance) {
+        ratio = dsg_utils::computeRatio(
+            config.min_distance, config.max_distance, slice.distances[i]);
+      } else {
+        ratio = dsg_utils::computeRatio(
+            config.min_weight, config.max_weight, slice.weights[i]);
       }
+
+      setSliceGridCell(Eigen::Vector2f(point.x, point.y), ratio, msg);
     }
   }
-
-  return msg;
 }
 
+}  // namespace
+
 void declare_config(ReconstructionVisualizer::Config& config) {
   using namespace config;
   name("ReconstructionVisualizerConfig");
@@ -148,8 +218,12 @@ void declare_config(ReconstructionVisualizer::Config& config) {
 }
 
 ReconstructionVisualizer::ReconstructionVisualizer(const Config& config)
-    : config_(config), nh_(config.ns) {
+    : config_(config), nh_(config.ns), cache_(new SliceCache()) {
   pubs_.reset(new MarkerGroupPub(nh_));
+  distance_grid_pub_ =
+      nh_.advertise<nav_msgs::OccupancyGrid>("tsdf_distance_slice", 1, true);
+  weight_grid_pub_ =
+      nh_.advertise<nav_msgs::OccupancyGrid>("tsdf_weight_slice", 1, true);
 }
 
 ReconstructionVisualizer::~ReconstructionVisualizer() {}
@@ -164,14 +238,88 @@ void ReconstructionVisualizer::call(uint64_t timestamp_ns,
                                     const Eigen::Isometry3d& world_T_sensor,
                                     const TsdfLayer& tsdf,
                                     const ReconstructionOutput&) const {
+  // only the colorings that someone is listening to are computed
+  const bool use_distance = pubs_->hasSubscribers("tsdf_viz");
+  const bool use_weight = pubs_->hasSubscribers("tsdf_weight_viz");
+  const bool use_distance_grid = distance_grid_pub_.getNumSubscribers() > 0;
+  const bool use_weight_grid = weight_grid_pub_.getNumSubscribers() > 0;
+  auto& cache = *cache_;
+  if (!use_distance && !use_weight && !use_distance_grid && !use_weight_grid) {
+    // blocks may change without being visited, so the cache has to be rebuilt
+    cache.valid = false;
+    cache.blocks.clear();
+    return;
+  }
+
+  auto height = config_.slice_height;
+  if (config_.use_relative_height) {
+    height += world_T_sensor.translation().z();
+  }
+
+  const Point slice_pos(0, 0, height);
+  const auto slice_index = tsdf.getBlockIndex(slice_pos);
+  const auto origin = spatial_hash::originPointFromIndex(slice_index, tsdf.blockSize());
+  const auto grid_index = spatial_hash::indexFromPoint<VoxelIndex>(
+      slice_pos - origin, tsdf.voxel_size_inv);
+
+  const bool reuse = cache.valid && cache.block_z == slice_index.z() &&
+                     cache.voxel_z == static_cast<size_t>(grid_index.z()) &&
+                     (cache.has_distance || !use_distance) &&
+                     (cache.has_weight || !use_weight);
+
+  // refreshed blocks need every coloring that the reused blocks have
+  const bool fill_distance = reuse ? cache.has_distance : use_distance;
+  const bool fill_weight = reuse ? cache.has_weight : use_weight;
+
+  // unchanged slices are moved over, which also drops blocks that were removed
+  std::unordered_map<BlockIndex, BlockSlice, IndexHash> blocks;
+  for (const auto& block : tsdf) {
+    if (block.index.z() != slice_index.z()) {
+      continue;
+    }
+
+    auto& slice = blocks[block.index];
+    auto iter = reuse ? cache.blocks.find(block.index) : cache.blocks.end();
+    if (iter != cache.blocks.end() && !block.updated) {
+      slice = std::move(iter->second);
+    } else {
+      fillBlockSlice(
+          config_, block, grid_index.z(), fill_distance, fill_weight, slice);
+    }
+  }
+
+  cache.blocks.swap(blocks);
+  if (!reuse) {
+    cache.valid = true;
+    cache.block_z = slice_index.z();
+    cache.voxel_z = grid_index.z();
+    cache.has_distance = fill_distance;
+    cache.has_weight = fill_weight;
+  }
+
   std_msgs::Header header;
   header.frame_id = GlobalInfo::instance().getFrames().map;
   header.stamp.fromNSec(timestamp_ns);
 
+  if (use_distance_grid) {
+    nav_msgs::OccupancyGrid msg;
+    fillTsdfGrid(config_, header, tsdf, cache, true, msg);
+    distance_grid_pub_.publish(msg);
+  }
+
+  if (use_weight_grid) {
+    nav_msgs::OccupancyGrid msg;
+    fillTsdfGrid(config_, header, tsdf, cache, false, msg);
+    weight_grid_pub_.publish(msg);
+  }
+
+  // subscribers may connect after the check above, so missing colorings are skipped
   pubs_->publish("tsdf_viz", [&](Marker& msg) {
-    msg = makeTsdfMarker(
-        config_, header, tsdf, world_T_sensor, colorVoxelByDist, "tsdf_distance_slice");
+    if (!cache.has_distance) {
+      return false;
+    }
 
+    fillTsdfMarker(header, tsdf, cache, true, "tsdf_distance_slice", msg);
     if (msg.points.size()) {
       return true;
     } else {
@@ -181,9 +329,11 @@ void ReconstructionVisualizer::call(uint64_t timestamp_ns,
   });
 
   pubs_->publish("tsdf_weight_viz", [&](Marker& msg) {
-    msg = makeTsdfMarker(
-        config_, header, tsdf, world_T_sensor, colorVoxelByWeight, "tsdf_weight_slice");
+    if (!cache.has_weight) {
+      return false;
+    }
 
+    fillTsdfMarker(header, tsdf, cache, false, "tsdf_weight_slice", msg);
     if (msg.points.size()) {
       return true;
     } else {
@@ -0,0 +1,368 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include "hydra_ros/utils/dsg_log.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace {
+
+inline constexpr uint64_t LOG_MAGIC = 0x32676f6c67736468;         // "hdsglog2"
+inline constexpr uint64_t LEGACY_LOG_MAGIC = 0x31676f6c67736468;  // "hdsglog1"
+inline constexpr uint64_t INDEX_MAGIC = 0x31786469676f6c68;       // "hlogidx1"
+inline constexpr uint32_t RECORD_MAGIC = 0x72677364;              // "dsgr"
+inline constexpr uint32_t FULL_UPDATE_FLAG = 0x1;
+
+// legacy logs only have the first four fields
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t flags;
+  uint64_t stamp_ns;
+  int64_t sequence_number;
+  uint64_t size;
+  //! Deleted node ids and edge endpoints stored after the contents
+  uint64_t num_deleted_nodes;
+  uint64_t num_deleted_edges;
+};
+
+static_assert(sizeof(RecordHeader) == 48, "unexpected padding in log record header");
+
+inline constexpr size_t LEGACY_HEADER_SIZE = 32;
+
+inline size_t headerSize(bool legacy) {
+  return legacy ? LEGACY_HEADER_SIZE : sizeof(RecordHeader);
+}
+
+inline uint64_t recordSize(const RecordHeader& header, bool legacy) {
+  return headerSize(legacy) + header.size +
+         sizeof(uint64_t) * (header.num_deleted_nodes + header.num_deleted_edges);
+}
+
+template <typename T>
+inline void writeValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool readValue(std::istream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return static_cast<bool>(in);
+}
+
+inline bool readHeader(std::istream& in, RecordHeader& header, bool legacy) {
+  header = RecordHeader{};
+  in.read(reinterpret_cast<char*>(&header), headerSize(legacy));
+  return static_cast<bool>(in);
+}
+
+inline void writeIds(std::ostream& out, const std::vector<uint64_t>& ids) {
+  out.write(reinterpret_cast<const char*>(ids.data()), sizeof(uint64_t) * ids.size());
+}
+
+inline bool readIds(std::istream& in, size_t num_ids, std::vector<uint64_t>& ids) {
+  ids.resize(num_ids);
+  in.read(reinterpret_cast<char*>(ids.data()), sizeof(uint64_t) * num_ids);
+  return static_cast<bool>(in);
+}
+
+}  // namespace
+
+DsgLogWriter::DsgLogWriter(const std::string& path)
+    : path_(path),
+      log_(path, std::ios::binary | std::ios::trunc),
+      index_(indexPath(path), std::ios::binary | std::ios::trunc),
+      num_records_(0),
+      size_(0) {
+  if (!log_ || !index_) {
+    throw std::runtime_error("failed to open dsg log at " + path);
+  }
+
+  writeValue(log_, LOG_MAGIC);
+  writeValue(index_, INDEX_MAGIC);
+  size_ = sizeof(LOG_MAGIC);
+}
+
+DsgLogWriter::~DsgLogWriter() { flush(); }
+
+std::string DsgLogWriter::indexPath(const std::string& log_path) {
+  return log_path + ".index";
+}
+
+bool DsgLogWriter::write(uint64_t stamp_ns,
+                         int64_t sequence_number,
+                         bool full_update,
+                         const uint8_t* data,
+                         size_t size,
+                         const std::vector<uint64_t>& deleted_nodes,
+                         const std::vector<uint64_t>& deleted_edges) {
+  const uint32_t flags = full_update ? FULL_UPDATE_FLAG : 0;
+  const RecordHeader header{RECORD_MAGIC,
+                            flags,
+                            stamp_ns,
+                            sequence_number,
+                            size,
+                            deleted_nodes.size(),
+                            deleted_edges.size()};
+  const uint64_t offset = size_;
+  writeValue(log_, header);
+  log_.write(reinterpret_cast<const char*>(data), size);
+  writeIds(log_, deleted_nodes);
+  writeIds(log_, deleted_edges);
+  if (!log_) {
+    LOG(ERROR) << "Failed to write record " << sequence_number << " to " << path_;
+    return false;
+  }
+
+  size_ += recordSize(header, false);
+  ++num_records_;
+  if (full_update) {
+    // written after the record so an index entry never points past the log
+    writeValue(index_, DsgLogReader::Keyframe{stamp_ns, offset});
+  }
+
+  return true;
+}
+
+void DsgLogWriter::flush() {
+  log_.flush();
+  index_.flush();
+}
+
+DsgLogReader::DsgLogReader(const std::string& path)
+    : path_(path),
+      log_(path, std::ios::binary),
+      log_size_(0),
+      valid_(false),
+      legacy_(false),
+      mapping_(nullptr) {
+  uint64_t magic = 0;
+  if (!log_ || !readValue(log_, magic) ||
+      (magic != LOG_MAGIC && magic != LEGACY_LOG_MAGIC)) {
+    LOG(ERROR) << "Invalid dsg log: " << path;
+    return;
+  }
+
+  legacy_ = magic == LEGACY_LOG_MAGIC;
+
+  log_.seekg(0, std::ios::end);
+  log_size_ = log_.tellg();
+  valid_ = true;
+
+  if (!loadIndex()) {
+    LOG(WARNING) << "Rebuilding missing or invalid keyframe index for " << path;
+    buildIndex();
+  }
+
+  rewind();
+}
+
+DsgLogReader::~DsgLogReader() {
+  if (mapping_) {
+    munmap(mapping_, log_size_);
+  }
+}
+
+bool DsgLogReader::loadIndex() {
+  std::ifstream index(DsgLogWriter::indexPath(path_), std::ios::binary);
+  uint64_t magic = 0;
+  if (!index || !readValue(index, magic) || magic != INDEX_MAGIC) {
+    return false;
+  }
+
+  keyframes_.clear();
+  Keyframe keyframe;
+  while (readValue(index, keyframe)) {
+    const bool in_order =
+        keyframes_.empty() || keyframe.offset > keyframes_.back().offset;
+    if (!in_order || keyframe.offset + headerSize(legacy_) > log_size_) {
+      return false;
+    }
+
+    keyframes_.push_back(keyframe);
+  }
+
+  return true;
+}
+
+void DsgLogReader::buildIndex() {
+  keyframes_.clear();
+  uint64_t offset = sizeof(LOG_MAGIC);
+  log_.clear();
+  log_.seekg(offset);
+
+  RecordHeader header;
+  while (readHeader(log_, header, legacy_) && header.magic == RECORD_MAGIC) {
+    const uint64_t next_offset = offset + recordSize(header, legacy_);
+    if (next_offset > log_size_) {
+      break;  // truncated record at the end of the log
+    }
+
+    if (header.flags & FULL_UPDATE_FLAG) {
+      keyframes_.push_back({header.stamp_ns, offset});
+    }
+
+    offset = next_offset;
+    log_.seekg(offset);
+  }
+}
+
+bool DsgLogReader::next(DsgLogRecord& record) {
+  if (!valid_) {
+    return false;
+  }
+
+  const uint64_t offset = log_.tellg();
+  RecordHeader header;
+  if (!readHeader(log_, header, legacy_) || header.magic != RECORD_MAGIC) {
+    return false;
+  }
+
+  if (offset + recordSize(header, legacy_) > log_size_) {
+    LOG(WARNING) << "Truncated record at end of " << path_;
+    return false;
+  }
+
+  record.stamp_ns = header.stamp_ns;
+  record.sequence_number = header.sequence_number;
+  record.full_update = header.flags & FULL_UPDATE_FLAG;
+  record.contents.resize(header.size);
+  log_.read(reinterpret_cast<char*>(record.contents.data()), header.size);
+  return readIds(log_, header.num_deleted_nodes, record.deleted_nodes) &&
+         readIds(log_, header.num_deleted_edges, record.deleted_edges);
+}
+
+bool DsgLogReader::seek(uint64_t stamp_ns) {
+  const auto index = findKeyframe(stamp_ns);
+  if (!valid_ || !index) {
+    return false;
+  }
+
+  log_.clear();
+  log_.seekg(keyframes_.at(*index).offset);
+  return true;
+}
+
+void DsgLogReader::rewind() {
+  log_.clear();
+  log_.seekg(sizeof(LOG_MAGIC));
+}
+
+std::optional<size_t> DsgLogReader::findKeyframe(uint64_t stamp_ns) const {
+  if (keyframes_.empty()) {
+    return std::nullopt;
+  }
+
+  const auto before = [](uint64_t stamp, const Keyframe& keyframe) {
+    return stamp < keyframe.stamp_ns;
+  };
+  auto iter = std::upper_bound(keyframes_.begin(), keyframes_.end(), stamp_ns, before);
+  if (iter != keyframes_.begin()) {
+    --iter;
+  }
+
+  return iter - keyframes_.begin();
+}
+
+bool DsgLogReader::map() const {
+  if (mapping_) {
+    return true;
+  }
+
+  const int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open " << path_ << " for mapping";
+    return false;
+  }
+
+  void* data = mmap(nullptr, log_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map " << path_;
+    return false;
+  }
+
+  mapping_ = data;
+  return true;
+}
+
+bool DsgLogReader::viewKeyframe(size_t index, const ViewCallback& callback) const {
+  if (!valid_ || index >= keyframes_.size() || !map()) {
+    return false;
+  }
+
+  const auto offset = keyframes_[index].offset;
+  const auto data = static_cast<const uint8_t*>(mapping_) + offset;
+  if (offset + headerSize(legacy_) > log_size_) {
+    LOG(ERROR) << "Invalid keyframe " << index << " in " << path_;
+    return false;
+  }
+
+  RecordHeader header{};
+  std::memcpy(&header, data, headerSize(legacy_));
+  if (header.magic != RECORD_MAGIC ||
+      offset + recordSize(header, legacy_) > log_size_) {
+    LOG(ERROR) << "Invalid keyframe " << index << " in " << path_;
+    return false;
+  }
+
+  callback(data + headerSize(legacy_), header.size);
+  return true;
+}
+
+std::optional<uint64_t> DsgLogReader::startTime() const {
+  if (keyframes_.empty()) {
+    return std::nullopt;
+  }
+
+  return keyframes_.front().stamp_ns;
+}
+
+std::optional<uint64_t> DsgLogReader::endTime() const {
+  if (keyframes_.empty()) {
+    return std::nullopt;
+  }
+
+  return keyframes_.back().stamp_ns;
+}
+
+}  // namespace hydra
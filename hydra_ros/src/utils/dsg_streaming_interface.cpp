@@ -40,11 +40,22 @@
 #include <hydra/utils/pgmo_mesh_traits.h>
 #include <hydra/utils/timing_utilities.h>
 #include <kimera_pgmo/utils/common_functions.h>
+#include <hydra_msgs/GetDsg.h>
 #include <kimera_pgmo_ros/conversion/ros_conversion.h>
+#include <ros/names.h>
 #include <spark_dsg/serialization/graph_binary_serialization.h>
 
 namespace hydra {
 
+// serialization buffers of released messages (shared with the messages so that they
+// can outlive the sender)
+struct DsgSender::BufferPool {
+  static constexpr size_t kMaxBuffers = 2;
+
+  std::mutex mutex;
+  std::vector<std::vector<uint8_t>> buffers;
+};
+
 DsgSender::DsgSender(const ros::NodeHandle& nh,
                      const std::string& frame_id,
                      const std::string& timer_name,
@@ -56,26 +67,78 @@ DsgSender::DsgSender(const ros::NodeHandle& nh,
       timer_name_(timer_name),
       publish_mesh_(publish_mesh),
       min_mesh_separation_s_(min_mesh_separation_s),
-      serialize_dsg_mesh_(serialize_dsg_mesh) {
+      serialize_dsg_mesh_(serialize_dsg_mesh),
+      buffers_(std::make_shared<BufferPool>()),
+      cached_version_(0),
+      graph_version_(0),
+      sequence_number_(0),
+      needs_full_update_(false) {
   pub_ = nh_.advertise<hydra_msgs::DsgUpdate>("dsg", 1);
   if (publish_mesh_) {
     mesh_pub_ = nh_.advertise<kimera_pgmo_msgs::KimeraPgmoMesh>("dsg_mesh", 1, false);
   }
+
+  bool use_shared_memory = false;
+  nh_.getParam("shared_memory/enable", use_shared_memory);
+  if (use_shared_memory) {
+    // updates that do not fit into a slot are sent inline instead
+    int num_slots = 2;
+    nh_.getParam("shared_memory/num_slots", num_slots);
+    double slot_capacity_mb = 32.0;
+    nh_.getParam("shared_memory/slot_capacity_mb", slot_capacity_mb);
+    double reader_timeout_s = 5.0;
+    nh_.getParam("shared_memory/reader_timeout_s", reader_timeout_s);
+
+    const auto segment = SharedMemoryRing::segmentName(pub_.getTopic());
+    const size_t slot_capacity = slot_capacity_mb * 1024 * 1024;
+    shared_ring_ = SharedMemoryRing::create(
+        segment, num_slots, slot_capacity, reader_timeout_s);
+    if (shared_ring_) {
+      shared_pub_ = nh_.advertise<hydra_msgs::SharedDsgUpdate>("dsg_shm", 1);
+    } else {
+      ROS_ERROR_STREAM("Failed to create shared memory for " << pub_.getTopic());
+    }
+  }
 }
 
 void DsgSender::sendGraph(const DynamicSceneGraph& graph,
                           const ros::Time& stamp) const {
-  const uint64_t timestamp_ns = stamp.toNSec();
-  timing::ScopedTimer timer(timer_name_, timestamp_ns);
+  timing::ScopedTimer timer(timer_name_, stamp.toNSec());
+  if (hasSubscribers()) {
+    sendSerialized(serializeGraph(graph, stamp, 0));
+  } else {
+    // the graph changed without being serialized: invalidate the cache
+    ++graph_version_;
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cached_msg_.reset();
+  }
 
-  if (pub_.getNumSubscribers()) {
-    hydra_msgs::DsgUpdate msg;
-    msg.header.stamp = stamp;
-    spark_dsg::io::binary::writeGraph(graph, msg.layer_contents, serialize_dsg_mesh_);
-    msg.full_update = true;
-    pub_.publish(msg);
+  sendMesh(graph, stamp);
+}
+
+hydra_msgs::DsgUpdate::Ptr DsgSender::serializeUpdate(const DynamicSceneGraph& graph,
+                                                      const ros::Time& stamp) const {
+  return serializeGraph(graph, stamp, 0);
+}
+
+void DsgSender::sendSerialized(const hydra_msgs::DsgUpdate::Ptr& msg) const {
+  // versions and sequence numbers follow the order in which updates are sent
+  const int64_t version = ++graph_version_;
+  needs_full_update_ = false;
+  msg->sequence_number = ++sequence_number_;
+  {  // the serialized graph is reused for any on-demand requests
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (!cached_msg_ || cached_version_ < version) {
+      cached_msg_ = msg;
+      cached_version_ = version;
+    }
   }
 
+  publishUpdate(msg);
+}
+
+void DsgSender::sendMesh(const DynamicSceneGraph& graph, const ros::Time& stamp) const {
+  const uint64_t timestamp_ns = stamp.toNSec();
   if (!publish_mesh_ || !mesh_pub_.getNumSubscribers()) {
     return;
   }
@@ -101,12 +164,226 @@ void DsgSender::sendGraph(const DynamicSceneGraph& graph,
   mesh_pub_.publish(msg);
 }
 
+void DsgSender::sendUpdate(const DynamicSceneGraph& graph,
+                           const DynamicSceneGraph& delta,
+                           const std::vector<NodeId>& deleted_nodes,
+                           const std::vector<std::pair<NodeId, NodeId>>& deleted_edges,
+                           const ros::Time& stamp) const {
+  if (needs_full_update_ && hasSubscribers()) {
+    // receivers may have missed changes that were never sent
+    sendGraph(graph, stamp);
+    return;
+  }
+
+  ++graph_version_;
+  {  // the cache only holds full graphs
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cached_msg_.reset();
+  }
+
+  if (!hasSubscribers()) {
+    needs_full_update_ = true;
+    return;
+  }
+
+  timing::ScopedTimer timer(timer_name_, stamp.toNSec());
+  hydra_msgs::DsgUpdate::Ptr msg(new hydra_msgs::DsgUpdate());
+  msg->header.stamp = stamp;
+  msg->header.frame_id = frame_id_;
+  msg->sequence_number = ++sequence_number_;
+  spark_dsg::io::binary::writeGraph(delta, msg->layer_contents, false);
+  msg->deleted_nodes.assign(deleted_nodes.begin(), deleted_nodes.end());
+  msg->deleted_edges.reserve(2 * deleted_edges.size());
+  for (const auto& [source, target] : deleted_edges) {
+    msg->deleted_edges.push_back(source);
+    msg->deleted_edges.push_back(target);
+  }
+
+  msg->full_update = false;
+  publishUpdate(msg);
+}
+
+bool DsgSender::hasSubscribers() const {
+  return pub_.getNumSubscribers() > 0 ||
+         (shared_ring_ && shared_pub_.getNumSubscribers() > 0);
+}
+
+hydra_msgs::DsgUpdate::ConstPtr DsgSender::getCachedGraph() const {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  return cached_msg_;
+}
+
+hydra_msgs::DsgUpdate::ConstPtr DsgSender::cacheGraph(const DynamicSceneGraph& graph,
+                                                      const ros::Time& stamp) const {
+  const int64_t version = graph_version_;
+  auto msg = serializeGraph(graph, stamp, sequence_number_);
+
+  // sendGraph may have cached (or invalidated) a newer graph while serializing
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  if (cached_msg_ && cached_version_ >= version) {
+    return cached_msg_;
+  }
+
+  if (graph_version_ == version) {
+    cached_msg_ = msg;
+    cached_version_ = version;
+  }
+
+  return msg;
+}
+
+hydra_msgs::DsgUpdate::Ptr DsgSender::serializeGraph(const DynamicSceneGraph& graph,
+                                                     const ros::Time& stamp,
+                                                     int64_t sequence_number) const {
+  // the deleter hands the buffer back once every copy of the message is released
+  hydra_msgs::DsgUpdate::Ptr msg(
+      new hydra_msgs::DsgUpdate(), [pool = buffers_](hydra_msgs::DsgUpdate* released) {
+        {
+          std::lock_guard<std::mutex> lock(pool->mutex);
+          if (pool->buffers.size() < BufferPool::kMaxBuffers) {
+            pool->buffers.push_back(std::move(released->layer_contents));
+          }
+        }
+
+        delete released;
+      });
+
+  {
+    std::lock_guard<std::mutex> lock(buffers_->mutex);
+    if (!buffers_->buffers.empty()) {
+      msg->layer_contents.swap(buffers_->buffers.back());
+      buffers_->buffers.pop_back();
+    }
+  }
+
+  msg->header.stamp = stamp;
+  msg->header.frame_id = frame_id_;
+  msg->sequence_number = sequence_number;
+  msg->layer_contents.clear();  // keeps the capacity of a recycled buffer
+  spark_dsg::io::binary::writeGraph(graph, msg->layer_contents, serialize_dsg_mesh_);
+  msg->full_update = true;
+  return msg;
+}
+
+void DsgSender::publishUpdate(const hydra_msgs::DsgUpdate::Ptr& msg) const {
+  if (shared_ring_ && shared_pub_.getNumSubscribers() > 0) {
+    sendShared(*msg);
+  }
+
+  if (pub_.getNumSubscribers() > 0) {
+    pub_.publish(msg);
+  }
+}
+
+void DsgSender::sendShared(const hydra_msgs::DsgUpdate& msg) const {
+  hydra_msgs::SharedDsgUpdate::Ptr shared_msg(new hydra_msgs::SharedDsgUpdate());
+  shared_msg->header = msg.header;
+  shared_msg->segment = shared_ring_->name();
+  shared_msg->segment_id = shared_ring_->instanceId();
+  shared_msg->full_update = msg.full_update;
+  shared_msg->sequence_number = msg.sequence_number;
+  shared_msg->deleted_nodes = msg.deleted_nodes;
+  shared_msg->deleted_edges = msg.deleted_edges;
+
+  const auto& contents = msg.layer_contents;
+  const auto token = shared_ring_->write(contents.data(), contents.size());
+  if (token) {
+    shared_msg->slot = token->slot;
+    shared_msg->version = token->version;
+  } else {
+    ROS_WARN_STREAM_THROTTLE(10.0,
+                             "Unable to write "
+                                 << getHumanReadableMemoryString(contents.size())
+                                 << " update to " << shared_ring_->name()
+                                 << ", sending inline instead");
+    shared_msg->layer_contents = contents;
+  }
+
+  shared_pub_.publish(shared_msg);
+}
+
+struct DsgReceiver::GraphPool {
+  std::mutex mutex;
+  DynamicSceneGraph::Ptr spare;
+  //! Update that the spare graph reflects
+  uint64_t spare_version = 0;
+};
+
+struct DsgReceiver::Delta {
+  //! Bounds the work (and memory) spent on catching up the spare graph
+  static constexpr size_t kMaxHistory = 8;
+
+  uint64_t version;
+  DynamicSceneGraph::Ptr graph;
+  std::vector<uint64_t> deleted_nodes;
+  std::vector<uint64_t> deleted_edges;
+};
+
+namespace {
+
+void applyDelta(DynamicSceneGraph& graph,
+                const DynamicSceneGraph& delta,
+                const std::vector<uint64_t>& deleted_nodes,
+                const std::vector<uint64_t>& deleted_edges) {
+  graph.mergeGraph(delta);
+  for (size_t i = 0; i + 1 < deleted_edges.size(); i += 2) {
+    if (graph.hasEdge(deleted_edges[i], deleted_edges[i + 1])) {
+      graph.removeEdge(deleted_edges[i], deleted_edges[i + 1]);
+    }
+  }
+
+  for (const auto node_id : deleted_nodes) {
+    if (graph.hasNode(node_id)) {
+      graph.removeNode(node_id);
+    }
+  }
+}
+
+}  // namespace
+
 DsgReceiver::DsgReceiver(const ros::NodeHandle& nh, bool subscribe_to_mesh)
-    : nh_(nh), has_update_(false), graph_(nullptr) {
-  sub_ = nh_.subscribe("dsg", 1, &DsgReceiver::handleUpdate, this);
+    : nh_(nh),
+      has_update_(false),
+      num_received_(0),
+      graph_(nullptr),
+      pool_(std::make_shared<GraphPool>()) {
+  bool apply_async = true;
+  nh_.getParam("apply_async", apply_async);
+  if (apply_async) {
+    worker_.reset(new SinkWorker("dsg_receiver"));
+  }
+
+  bool use_shared_memory = false;
+  nh_.getParam("use_shared_memory", use_shared_memory);
+  if (use_shared_memory) {
+    sub_ = nh_.subscribe("dsg_shm", 1, &DsgReceiver::handleSharedUpdate, this);
+  } else {
+    sub_ = nh_.subscribe("dsg", 1, &DsgReceiver::handleUpdate, this);
+  }
+
   if (subscribe_to_mesh) {
     mesh_sub_ = nh_.subscribe("dsg_mesh_updates", 1, &DsgReceiver::handleMesh, this);
   }
+
+  // full graph requested from the sender when an update is lost for good, which
+  // the sender advertises next to its update topic (after any remapping)
+  std::string resync_service = ros::names::parentNamespace(sub_.getTopic());
+  resync_service += resync_service == "/" ? "get_dsg" : "/get_dsg";
+  nh_.getParam("resync_service", resync_service);
+  if (!resync_service.empty()) {
+    resync_client_ = nh_.serviceClient<hydra_msgs::GetDsg>(resync_service);
+  }
+
+  stats_.last_sequence_number = -1;
+  stats_pub_ = nh_.advertise<hydra_msgs::DsgReceiverStats>("dsg_stats", 1, true);
+  double stats_period_s = 1.0;
+  nh_.getParam("stats_period_s", stats_period_s);
+  if (stats_period_s > 0.0) {
+    // keep the stats current for subscribers even when no updates arrive
+    stats_timer_ = nh_.createWallTimer(
+        ros::WallDuration(stats_period_s),
+        [this](const ros::WallTimerEvent&) { publishStats(); });
+  }
 }
 
 DsgReceiver::DsgReceiver(const ros::NodeHandle& nh, const LogCallback& log_cb)
@@ -114,33 +391,288 @@ DsgReceiver::DsgReceiver(const ros::NodeHandle& nh, const LogCallback& log_cb)
   log_callback_.reset(new LogCallback(log_cb));
 }
 
+DsgReceiver::~DsgReceiver() {
+  sub_.shutdown();
+  mesh_sub_.shutdown();
+  stats_timer_.stop();
+  worker_.reset();
+}
+
+DynamicSceneGraph::Ptr DsgReceiver::graph() const {
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  return graph_;
+}
+
+std::optional<int64_t> DsgReceiver::sequenceNumber() const {
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  return sequence_number_;
+}
+
+hydra_msgs::DsgReceiverStats DsgReceiver::stats() const {
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  auto stats = stats_;
+  stats.num_received = num_received_;
+  stats.num_coalesced = worker_ ? worker_->numDropped() : 0;
+  return stats;
+}
+
 void DsgReceiver::handleUpdate(const hydra_msgs::DsgUpdate::ConstPtr& msg) {
-  timing::ScopedTimer timer("receive_dsg", msg->header.stamp.toNSec());
-  if (!msg->full_update) {
-    throw std::runtime_error("not implemented");
+  countReceived(msg->sequence_number);
+  if (!worker_) {
+    processUpdate(msg);
+    return;
+  }
+
+  // deserialize off of the spinning thread so that consumers never block on updates.
+  // only the newest pending update is kept: a dropped incremental update shows up as
+  // a gap and is recovered by a resync
+  worker_->push([this, msg]() { processUpdate(msg); });
+}
+
+void DsgReceiver::handleSharedUpdate(const hydra_msgs::SharedDsgUpdate::ConstPtr& msg) {
+  countReceived(msg->sequence_number);
+  if (!worker_) {
+    processSharedUpdate(msg);
+    return;
+  }
+
+  worker_->push([this, msg]() { processSharedUpdate(msg); });
+}
+
+void DsgReceiver::processUpdate(const hydra_msgs::DsgUpdate::ConstPtr& msg) {
+  const auto& contents = msg->layer_contents;
+  if (!applyUpdate(msg->header,
+                   msg->sequence_number,
+                   msg->full_update,
+                   contents.data(),
+                   contents.size(),
+                   msg->deleted_nodes,
+                   msg->deleted_edges)) {
+    resync("invalid update");
+  }
+}
+
+void DsgReceiver::processSharedUpdate(
+    const hydra_msgs::SharedDsgUpdate::ConstPtr& msg) {
+  if (!msg->layer_contents.empty()) {
+    const auto& contents = msg->layer_contents;
+    if (!applyUpdate(msg->header,
+                     msg->sequence_number,
+                     msg->full_update,
+                     contents.data(),
+                     contents.size(),
+                     msg->deleted_nodes,
+                     msg->deleted_edges)) {
+      resync("invalid update");
+    }
+    return;
+  }
+
+  if (!shared_ring_ || shared_ring_->name() != msg->segment ||
+      shared_ring_->instanceId() != msg->segment_id) {
+    shared_ring_ = SharedMemoryRing::open(msg->segment);
+    if (!shared_ring_) {
+      ROS_ERROR_STREAM("Unable to open " << msg->segment << ": is the sender local?");
+      return;
+    }
+  }
+
+  bool applied = false;
+  const SharedMemoryRing::Token token{msg->slot, msg->version};
+  const bool valid = shared_ring_->read(token, [&](const uint8_t* buffer, size_t size) {
+    applied = applyUpdate(msg->header,
+                          msg->sequence_number,
+                          msg->full_update,
+                          buffer,
+                          size,
+                          msg->deleted_nodes,
+                          msg->deleted_edges);
+  });
+
+  if (!valid) {
+    {
+      std::lock_guard<std::mutex> lock(graph_mutex_);
+      ++stats_.num_failed;
+    }
+
+    resync("update " + std::to_string(msg->sequence_number) + " was overwritten");
+  } else if (!applied) {
+    resync("invalid update");
+  }
+}
+
+bool DsgReceiver::applyUpdate(const std_msgs::Header& header,
+                              int64_t sequence_number,
+                              bool full_update,
+                              const uint8_t* buffer,
+                              size_t length,
+                              const std::vector<uint64_t>& deleted_nodes,
+                              const std::vector<uint64_t>& deleted_edges) {
+  timing::ScopedTimer timer("receive_dsg", header.stamp.toNSec());
+  std::optional<int64_t> prev_sequence_number;
+  DynamicSceneGraph::Ptr current;
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex_);
+    prev_sequence_number = sequence_number_;
+    current = graph_;
+  }
+
+  // a smaller sequence number means the sender restarted and is not a gap
+  const bool have_gap =
+      prev_sequence_number && sequence_number > *prev_sequence_number + 1;
+
+  if (!full_update && (have_gap || !current)) {
+    // incremental updates can't be applied on top of a missing update
+    resync("missed updates before " + std::to_string(sequence_number));
+    return true;
   }
 
   if (log_callback_) {
-    (*log_callback_)(msg->header.stamp, msg->layer_contents.size());
+    (*log_callback_)(header.stamp, length);
   }
 
-  const auto size_bytes = getHumanReadableMemoryString(msg->layer_contents.size());
-  VLOG(5) << "Received dsg update message of " << size_bytes;
+  VLOG(5) << "Received dsg update message of " << getHumanReadableMemoryString(length);
+
+  // nobody holds the spare graph anymore, so it can be updated in place
+  DynamicSceneGraph::Ptr target;
+  uint64_t target_version = 0;
+  {
+    std::lock_guard<std::mutex> lock(pool_->mutex);
+    target = std::move(pool_->spare);
+    target_version = pool_->spare_version;
+  }
+
+  const uint64_t version = version_ + 1;
   try {
-    if (!graph_) {
-      graph_ = spark_dsg::io::binary::readGraph(msg->layer_contents);
+    if (!full_update) {
+      // consumers may hold the current graph: apply the changes to the spare graph
+      // after catching it up, and only copy the current graph if that isn't possible
+      const DynamicSceneGraph::Ptr delta =
+          spark_dsg::io::binary::readGraph(buffer, length);
+      if (!target || !replayUpdates(*target, target_version)) {
+        target = current->clone();
+      }
+
+      applyDelta(*target, *delta, deleted_nodes, deleted_edges);
+      history_.push_back({version, delta, deleted_nodes, deleted_edges});
+      if (history_.size() > Delta::kMaxHistory) {
+        // graphs from before the oldest delta have to be copied instead
+        base_version_ = history_.front().version;
+        history_.pop_front();
+      }
+    } else if (!target) {
+      target = spark_dsg::io::binary::readGraph(buffer, length);
     } else {
-      spark_dsg::io::binary::updateGraph(*graph_, msg->layer_contents);
+      spark_dsg::io::binary::updateGraph(*target, buffer, length);
     }
-    has_update_ = true;
   } catch (const std::exception& e) {
-    ROS_FATAL_STREAM("Received invalid message: " << e.what());
-    ros::shutdown();
+    ROS_ERROR_STREAM("Received invalid message: " << e.what());
+    std::lock_guard<std::mutex> lock(graph_mutex_);
+    ++stats_.num_failed;
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex_);
+    if (mesh_) {
+      target->setMesh(mesh_);
+    }
+
+    graph_ = makeRecyclable(target, version);
+    sequence_number_ = sequence_number;
+    stats_.header.stamp = header.stamp;
+    stats_.last_sequence_number = sequence_number;
+    ++stats_.num_applied;
+  }
+
+  version_ = version;
+  if (full_update) {
+    history_.clear();
+    base_version_ = version;
+  }
+
+  has_update_ = true;
+  publishStats();
+  return true;
+}
+
+bool DsgReceiver::replayUpdates(DynamicSceneGraph& graph,
+                                uint64_t graph_version) const {
+  if (graph_version < base_version_ || graph_version > version_) {
+    return false;
+  }
+
+  for (const auto& delta : history_) {
+    if (delta.version > graph_version) {
+      applyDelta(graph, *delta.graph, delta.deleted_nodes, delta.deleted_edges);
+    }
+  }
+
+  return true;
+}
+
+void DsgReceiver::resync(const std::string& reason) {
+  if (!resync_client_ || !resync_client_.exists()) {
+    ROS_WARN_STREAM("Unable to resync after " << reason << ": waiting for next update");
     return;
   }
 
-  if (mesh_) {
-    graph_->setMesh(mesh_);
+  ROS_WARN_STREAM("Requesting full graph after " << reason);
+  hydra_msgs::GetDsg srv;
+  if (!resync_client_.call(srv)) {
+    ROS_ERROR_STREAM("Failed to call " << resync_client_.getService());
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex_);
+    ++stats_.num_resyncs;
+    // the response is applied as-is and should never count as a gap
+    sequence_number_.reset();
+  }
+
+  const auto& msg = srv.response.graph;
+  const auto& contents = msg.layer_contents;
+  if (!applyUpdate(msg.header,
+                   msg.sequence_number,
+                   msg.full_update,
+                   contents.data(),
+                   contents.size())) {
+    ROS_ERROR("Received invalid graph from resync request");
+  }
+}
+
+DynamicSceneGraph::Ptr DsgReceiver::makeRecyclable(const DynamicSceneGraph::Ptr& graph,
+                                                   uint64_t version) const {
+  // the deleter owns the actual graph and hands it to the pool instead of freeing it
+  std::weak_ptr<GraphPool> weak_pool = pool_;
+  return DynamicSceneGraph::Ptr(
+      graph.get(), [graph, version, weak_pool](DynamicSceneGraph*) {
+        const auto pool = weak_pool.lock();
+        if (!pool) {
+          return;
+        }
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->spare = graph;
+        pool->spare_version = version;
+      });
+}
+
+void DsgReceiver::countReceived(int64_t sequence_number) {
+  ++num_received_;
+  std::lock_guard<std::mutex> lock(graph_mutex_);
+  // a smaller sequence number means the sender restarted and is not a gap
+  if (last_received_ && sequence_number > *last_received_ + 1) {
+    stats_.num_missed += sequence_number - *last_received_ - 1;
+  }
+
+  last_received_ = sequence_number;
+}
+
+void DsgReceiver::publishStats() {
+  if (stats_pub_.getNumSubscribers() > 0) {
+    stats_pub_.publish(stats());
   }
 }
 
@@ -149,6 +681,7 @@ void DsgReceiver::handleMesh(const kimera_pgmo_msgs::KimeraPgmoMesh::ConstPtr& m
     return;
   }
   timing::ScopedTimer timer("receive_mesh", msg->header.stamp.toNSec());
+  std::lock_guard<std::mutex> lock(graph_mutex_);
   if (!mesh_) {
     mesh_ = std::make_shared<Mesh>();
   }
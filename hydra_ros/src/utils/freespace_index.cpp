@@ -0,0 +1,211 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include "hydra_ros/utils/freespace_index.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace hydra {
+
+FreespaceIndex::FreespaceIndex(double cell_size) : cell_size_(cell_size) {
+  CHECK_GT(cell_size_, 0.0) << "cell size must be positive";
+}
+
+size_t FreespaceIndex::update(const SceneGraphLayer& places) {
+  size_t num_changed = 0;
+  std::unordered_set<NodeId> seen;
+  seen.reserve(places.numNodes());
+  for (const auto& id_node_pair : places.nodes()) {
+    const auto& attrs = id_node_pair.second->attributes<PlaceNodeAttributes>();
+    if (!attrs.real_place) {
+      continue;
+    }
+
+    seen.insert(id_node_pair.first);
+    const auto iter = spheres_.find(id_node_pair.first);
+    if (iter != spheres_.end() && iter->second.center == attrs.position &&
+        iter->second.radius == attrs.distance) {
+      continue;
+    }
+
+    insert(id_node_pair.first, attrs.position, attrs.distance);
+    ++num_changed;
+  }
+
+  std::vector<NodeId> removed;
+  for (const auto& id_sphere_pair : spheres_) {
+    if (!seen.count(id_sphere_pair.first)) {
+      removed.push_back(id_sphere_pair.first);
+    }
+  }
+
+  for (const auto node : removed) {
+    erase(node);
+  }
+
+  return num_changed + removed.size();
+}
+
+void FreespaceIndex::insert(NodeId node,
+                            const Eigen::Vector3d& center,
+                            double radius) {
+  const Sphere sphere{center, radius};
+  auto iter = spheres_.find(node);
+  if (iter == spheres_.end()) {
+    spheres_.emplace(node, sphere);
+  } else {
+    eraseFromCells(node, iter->second);
+    iter->second = sphere;
+  }
+
+  insertIntoCells(node, sphere);
+}
+
+void FreespaceIndex::erase(NodeId node) {
+  auto iter = spheres_.find(node);
+  if (iter == spheres_.end()) {
+    return;
+  }
+
+  eraseFromCells(node, iter->second);
+  spheres_.erase(iter);
+}
+
+void FreespaceIndex::clear() {
+  spheres_.clear();
+  cells_.clear();
+}
+
+bool FreespaceIndex::inFreespace(const Eigen::Vector3d& point,
+                                 double min_clearance) const {
+  Eigen::Matrix3Xd points(3, 1);
+  points.col(0) = point;
+  return batchInFreespace(points, min_clearance).front();
+}
+
+std::vector<int8_t> FreespaceIndex::batchInFreespace(const Eigen::Matrix3Xd& points,
+                                                     double min_clearance) const {
+  std::vector<int8_t> result(points.cols(), 0);
+  if (spheres_.empty()) {
+    return result;
+  }
+
+  // bucket the query points so each cell's candidates are only gathered once
+  std::unordered_map<CellIndex, std::vector<size_t>, IndexHash> buckets;
+  for (int i = 0; i < points.cols(); ++i) {
+    buckets[toCell(points.col(i))].push_back(i);
+  }
+
+  Eigen::Matrix3Xd centers;
+  Eigen::VectorXd radii;
+  for (const auto& [cell, indices] : buckets) {
+    getCandidates(cell, centers, radii);
+    if (!centers.cols()) {
+      continue;
+    }
+
+    // a point is free if it is at least min_clearance inside some sphere
+    const Eigen::ArrayXd thresholds_sq =
+        (radii.array() - min_clearance).max(0.0).square();
+    for (const auto idx : indices) {
+      const Eigen::ArrayXd dists_sq =
+          (centers.colwise() - points.col(idx)).colwise().squaredNorm().transpose();
+      result[idx] = (dists_sq < thresholds_sq).any() ? 1 : 0;
+    }
+  }
+
+  return result;
+}
+
+FreespaceIndex::CellIndex FreespaceIndex::toCell(const Eigen::Vector3d& point) const {
+  return (point / cell_size_).array().floor().cast<int>().matrix();
+}
+
+void FreespaceIndex::insertIntoCells(NodeId node, const Sphere& sphere) {
+  const auto lower = toCell(sphere.center - Eigen::Vector3d::Constant(sphere.radius));
+  const auto upper = toCell(sphere.center + Eigen::Vector3d::Constant(sphere.radius));
+  for (int x = lower.x(); x <= upper.x(); ++x) {
+    for (int y = lower.y(); y <= upper.y(); ++y) {
+      for (int z = lower.z(); z <= upper.z(); ++z) {
+        cells_[CellIndex(x, y, z)].push_back(node);
+      }
+    }
+  }
+}
+
+void FreespaceIndex::eraseFromCells(NodeId node, const Sphere& sphere) {
+  const auto lower = toCell(sphere.center - Eigen::Vector3d::Constant(sphere.radius));
+  const auto upper = toCell(sphere.center + Eigen::Vector3d::Constant(sphere.radius));
+  for (int x = lower.x(); x <= upper.x(); ++x) {
+    for (int y = lower.y(); y <= upper.y(); ++y) {
+      for (int z = lower.z(); z <= upper.z(); ++z) {
+        auto iter = cells_.find(CellIndex(x, y, z));
+        if (iter == cells_.end()) {
+          continue;
+        }
+
+        auto& nodes = iter->second;
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+        if (nodes.empty()) {
+          cells_.erase(iter);
+        }
+      }
+    }
+  }
+}
+
+void FreespaceIndex::getCandidates(const CellIndex& cell,
+                                   Eigen::Matrix3Xd& centers,
+                                   Eigen::VectorXd& radii) const {
+  const auto iter = cells_.find(cell);
+  if (iter == cells_.end()) {
+    centers.resize(3, 0);
+    radii.resize(0);
+    return;
+  }
+
+  const auto& nodes = iter->second;
+  centers.resize(3, nodes.size());
+  radii.resize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const auto& sphere = spheres_.at(nodes[i]);
+    centers.col(i) = sphere.center;
+    radii(i) = sphere.radius;
+  }
+}
+
+}  // namespace hydra
@@ -40,8 +40,22 @@
 #include <config_utilities/types/eigen_matrix.h>
 #include <config_utilities/validation.h>
 #include <hydra/common/global_info.h>
+#include <hydra_msgs/ElevationMap.h>
+#include <map_msgs/OccupancyGridUpdate.h>
 #include <nav_msgs/OccupancyGrid.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hydra_ros/utils/cell_grid.h"
+#include "hydra_ros/utils/index_hash.h"
+
 namespace hydra {
 
 template <typename T>
@@ -74,150 +88,510 @@ bool isObserved(const places::GvdVoxel& voxel, float) {
   return voxel.observed;
 }
 
-struct Bounds {
-  Eigen::Vector2f x_min = Eigen::Vector2f::Constant(std::numeric_limits<float>::max());
-  Eigen::Vector2f x_max =
-      Eigen::Vector2f::Constant(std::numeric_limits<float>::lowest());
-  Eigen::Vector2f dims = Eigen::Vector2f::Zero();
+using Column = CellGrid::Index;
+
+using ColumnSet = std::unordered_set<Column, IndexHash>;
+
+//! Block z index and voxel z index of a single slice through the layer
+using SliceKey = std::pair<int, int>;
+
+struct OccupancyPublisher::State : CellGrid {
+  //! Whether the grid reflects the last layer that was published
+  bool valid = false;
+  //! Set from subscriber callbacks when the full grid needs to be resent
+  std::atomic<bool> send_full{true};
+  //! Set when a subscriber to the updates connects and needs the whole grid as a patch
+  std::atomic<bool> send_base_update{false};
+  std::vector<SliceKey> slices;
+  //! Block columns with at least one slice block when the grid was last updated
+  ColumnSet columns;
+  //! Block columns that the robot footprint overlapped when last updated
+  ColumnSet footprint_columns;
+  nav_msgs::OccupancyGrid msg;
+  //! Elevation map kept between calls so that its layers reuse their storage
+  hydra_msgs::ElevationMap elevation;
+
+  void reset() {
+    CellGrid::reset();
+    valid = false;
+    columns.clear();
+    footprint_columns.clear();
+  }
 };
 
-template <typename BlockT>
-Bounds getLayerBounds(const spatial_hash::VoxelLayer<BlockT>& layer) {
-  Bounds bounds;
-
-  for (const auto& block : layer) {
-    const auto lower = block.origin();
-    const auto upper = lower + Point::Constant(block.block_size);
-    bounds.x_min = bounds.x_min.array().min(lower.template head<2>().array());
-    bounds.x_max = bounds.x_max.array().max(upper.template head<2>().array());
+namespace {
+
+// resets the cells of a column to unknown
+void clearColumn(const Column& column, OccupancyPublisher::State& state) {
+  auto& cells = state.cells();
+  const Column offset = column * state.voxels_per_side;
+  for (int y = 0; y < state.voxels_per_side; ++y) {
+    for (int x = 0; x < state.voxels_per_side; ++x) {
+      const size_t index = state.cellIndex(offset + Column(x, y));
+      if (index != OccupancyPublisher::State::INVALID) {
+        cells[index] = -1;
+      }
+    }
   }
-
-  bounds.dims = (bounds.x_max - bounds.x_min) / layer.voxel_size;
-  return bounds;
-}
-
-template <typename BlockT>
-void initGrid(const spatial_hash::VoxelLayer<BlockT>& layer,
-              const Bounds& bounds,
-              double height,
-              nav_msgs::OccupancyGrid& msg) {
-  msg.info.resolution = layer.voxel_size;
-  msg.info.width = std::ceil(bounds.dims.x());
-  msg.info.height = std::ceil(bounds.dims.y());
-  msg.info.origin.position.x = bounds.x_min.x();
-  msg.info.origin.position.y = bounds.x_min.y();
-  msg.info.origin.position.z = height;
-  msg.info.origin.orientation.w = 1.0;
-  msg.data.resize(msg.info.width * msg.info.height, -1);
 }
 
+// recomputes every cell of a block column from the slices through it (columns cover
+// disjoint cells, so different columns can be filled concurrently). Slice voxels
+// inside the robot footprint are marked free, which is only checked for columns
+// under the footprint.
 template <typename BlockT>
-void fillOccupancySlice(const OccupancyPublisher::Config& config,
-                        const spatial_hash::VoxelLayer<BlockT>& layer,
-                        const Eigen::Isometry3d& world_T_sensor,
-                        const Bounds& bounds,
-                        double height,
-                        nav_msgs::OccupancyGrid& msg) {
-  const Point slice_pos(0, 0, height);
-  const auto slice_key = layer.getVoxelKey(slice_pos);
-  auto bbox = config.add_robot_footprint
-                  ? BoundingBox(config.footprint_min, config.footprint_max)
-                  : BoundingBox();
-  const Eigen::Isometry3f sensor_T_world = world_T_sensor.inverse().cast<float>();
+void fillColumn(const OccupancyPublisher::Config& config,
+                const spatial_hash::VoxelLayer<BlockT>& layer,
+                const Eigen::Isometry3f& sensor_T_world,
+                bool in_footprint,
+                const Column& column,
+                OccupancyPublisher::State& state) {
+  clearColumn(column, state);
+
+  const BoundingBox bbox(config.footprint_min, config.footprint_max);
+  auto& data = state.cells();
+  const Column offset = column * state.voxels_per_side;
+  for (const auto& [block_z, voxel_z] : state.slices) {
+    const auto block_ptr =
+        layer.getBlockPtr(spatial_hash::BlockIndex(column.x(), column.y(), block_z));
+    if (!block_ptr) {
+      continue;
+    }
 
-  for (const auto block_ptr :
-       layer.blocksWithCondition([&slice_key](const BlockT& block) {
-         return block.index.z() == slice_key.first.z();
-       })) {
-    for (size_t x = 0; x < block_ptr->voxels_per_side; ++x) {
-      for (size_t y = 0; y < block_ptr->voxels_per_side; ++y) {
-        const VoxelIndex voxel_index(x, y, slice_key.second.z());
-        const auto& voxel = block_ptr->getVoxel(voxel_index);
-        const Eigen::Vector3f pos = block_ptr->getVoxelPosition(voxel_index);
-        const auto rel_pos = pos.head<2>() - bounds.x_min;
-        // pos is center point, so we want floor
-        const auto r = std::floor(rel_pos.y() / layer.voxel_size);
-        const auto c = std::floor(rel_pos.x() / layer.voxel_size);
-        const size_t index = r * msg.info.width + c;
-
-        if (config.add_robot_footprint &&
-            bbox.contains((sensor_T_world * pos).eval())) {
-          msg.data[index] = 0;
+    for (int y = 0; y < state.voxels_per_side; ++y) {
+      for (int x = 0; x < state.voxels_per_side; ++x) {
+        const size_t index = state.cellIndex(offset + Column(x, y));
+        if (index == OccupancyPublisher::State::INVALID) {
           continue;
         }
 
+        const VoxelIndex voxel_index(x, y, voxel_z);
+        if (in_footprint) {
+          const Eigen::Vector3f pos = block_ptr->getVoxelPosition(voxel_index);
+          if (bbox.contains((sensor_T_world * pos).eval())) {
+            data[index] = 0;
+            continue;
+          }
+        }
+
+        const auto& voxel = block_ptr->getVoxel(voxel_index);
         if (!isObserved(voxel, config.min_observation_weight)) {
-          msg.data[index] = -2;
+          data[index] = -2;
           continue;
         }
 
         const auto occupied = getDistance(voxel) < config.min_distance;
         if (occupied) {
-          msg.data[index] = 100;
+          data[index] = 100;
           continue;
         }
 
-        if (msg.data[index] == -1) {
+        if (data[index] == -1) {
           // we only can mark cells as free if they haven't been touched
-          msg.data[index] = 0;
+          data[index] = 0;
         }
       }
     }
   }
+
+  // clean up all cells that were marked unobserved
+  for (int y = 0; y < state.voxels_per_side; ++y) {
+    for (int x = 0; x < state.voxels_per_side; ++x) {
+      const size_t index = state.cellIndex(offset + Column(x, y));
+      if (index != OccupancyPublisher::State::INVALID && data[index] == -2) {
+        data[index] = -1;
+      }
+    }
+  }
 }
 
-template <typename BlockT>
-void fillOccupancy(const OccupancyPublisher::Config& config,
-                   const spatial_hash::VoxelLayer<BlockT>& layer,
-                   const Eigen::Isometry3d& world_T_sensor,
-                   nav_msgs::OccupancyGrid& msg) {
-  const auto bounds = getLayerBounds(layer);
+// x-y extent of the robot footprint (in the sensor frame) in the world frame
+Eigen::AlignedBox2f getFootprintExtent(const OccupancyPublisher::Config& config,
+                                       const Eigen::Isometry3d& world_T_sensor) {
+  Eigen::AlignedBox2f extent;
+  const Eigen::Isometry3f world_T_sensor_f = world_T_sensor.cast<float>();
+  for (int c = 0; c < 8; ++c) {
+    const Eigen::Vector3f corner((c & 0x01) ? config.footprint_max.x()
+                                            : config.footprint_min.x(),
+                                 (c & 0x02) ? config.footprint_max.y()
+                                            : config.footprint_min.y(),
+                                 (c & 0x04) ? config.footprint_max.z()
+                                            : config.footprint_min.z());
+    extent.extend((world_T_sensor_f * corner).head<2>());
+  }
+
+  return extent;
+}
+
+// block columns that the robot footprint overlaps
+ColumnSet getFootprintColumns(const OccupancyPublisher::Config& config,
+                              const Eigen::Isometry3d& world_T_sensor,
+                              float block_size) {
+  ColumnSet columns;
+  if (!config.add_robot_footprint) {
+    return columns;
+  }
+
+  const auto extent = getFootprintExtent(config, world_T_sensor);
+  const Column min_column =
+      (extent.min() / block_size).array().floor().cast<int>().matrix();
+  const Column max_column =
+      (extent.max() / block_size).array().floor().cast<int>().matrix();
+  for (int x = min_column.x(); x <= max_column.x(); ++x) {
+    for (int y = min_column.y(); y <= max_column.y(); ++y) {
+      columns.emplace(x, y);
+    }
+  }
+
+  return columns;
+}
+
+void fillUpdate(const OccupancyPublisher::State& state,
+                const CellGrid::Bounds& bounds,
+                map_msgs::OccupancyGridUpdate& msg) {
+  const auto region = state.copyRegion(bounds, msg.data);
+  msg.x = region.min.x();
+  msg.y = region.min.y();
+  msg.width = region.max.x() - region.min.x() + 1;
+  msg.height = region.max.y() - region.min.y() + 1;
+}
+
+// publishes the grid cells, which are moved into the message while it is serialized
+void publishGrid(const ros::Publisher& pub,
+                 const std_msgs::Header& header,
+                 OccupancyPublisher::State& state) {
+  auto& msg = state.msg;
+  msg.header = header;
+  msg.info.map_load_time = header.stamp;
+  msg.info.width = state.size.x();
+  msg.info.height = state.size.y();
+  msg.info.origin.position.x = state.origin.x() * state.voxel_size;
+  msg.info.origin.position.y = state.origin.y() * state.voxel_size;
+  msg.data.swap(state.data);
+  pub.publish(msg);
+  msg.data.swap(state.data);
+}
+
+double getSliceHeight(const OccupancyPublisher::Config& config,
+                      const Eigen::Isometry3d& world_T_sensor) {
   auto height = config.slice_height;
   if (config.use_relative_height) {
     height += world_T_sensor.translation().z();
   }
 
-  initGrid(layer, bounds, height, msg);
-  for (size_t i = 0; i < config.num_slices; ++i) {
-    const auto curr_height = height + i * layer.voxel_size;
-    fillOccupancySlice(config, layer, world_T_sensor, bounds, curr_height, msg);
+  return height;
+}
+
+//! Voxel z indices (and the block z indices containing them) of the elevation band
+struct Band {
+  int z_min;
+  int z_max;
+  int block_z_min;
+  int block_z_max;
+
+  Band(const OccupancyPublisher::Config& config,
+       float voxel_size,
+       int voxels_per_side,
+       double height)
+      : z_min(std::floor((height + config.elevation_min_height) / voxel_size)),
+        z_max(std::floor((height + config.elevation_max_height) / voxel_size)),
+        block_z_min(floorDiv(z_min, voxels_per_side)),
+        block_z_max(floorDiv(z_max, voxels_per_side)) {}
+};
+
+/**
+ * @brief Fill the elevation map for the cells in [origin, origin + size)
+ *
+ * Every voxel in the band is visited once, scanning each cell from the bottom of the
+ * band up. The ground is the top of the lowest run of surface voxels (at or below
+ * elevation_surface_distance) and the clearance is the free space between the ground
+ * and the next surface voxel (or the top of the band). Unobserved voxels are skipped.
+ */
+template <typename BlockT>
+void fillElevation(const OccupancyPublisher::Config& config,
+                   const spatial_hash::VoxelLayer<BlockT>& layer,
+                   const Band& band,
+                   const Column& origin,
+                   const Column& size,
+                   hydra_msgs::ElevationMap& msg) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const int vps = layer.voxels_per_side;
+  const float voxel_size = layer.voxel_size;
+
+  msg.resolution = voxel_size;
+  msg.width = size.x();
+  msg.height = size.y();
+  msg.origin_x = origin.x() * voxel_size;
+  msg.origin_y = origin.y() * voxel_size;
+  msg.layers = {"min_height", "max_height", "elevation", "clearance", "traversable"};
+  msg.data.resize(msg.layers.size());
+  for (auto& layer_msg : msg.data) {
+    layer_msg.layout.dim.resize(2);
+    layer_msg.layout.dim[0].label = "y";
+    layer_msg.layout.dim[0].size = msg.height;
+    layer_msg.layout.dim[0].stride = msg.width * msg.height;
+    layer_msg.layout.dim[1].label = "x";
+    layer_msg.layout.dim[1].size = msg.width;
+    layer_msg.layout.dim[1].stride = msg.width;
+    layer_msg.data.assign(size.prod(), nan);
   }
 
-  // clean up all cells that were marked unobserved
-  for (size_t i = 0; i < msg.data.size(); ++i) {
-    if (msg.data[i] == -2) {
-      msg.data[i] = -1;
+  auto& min_heights = msg.data[0].data;
+  auto& max_heights = msg.data[1].data;
+  auto& ground = msg.data[2].data;
+  auto& clearance = msg.data[3].data;
+  auto& traversable = msg.data[4].data;
+
+  const float band_top = (band.z_max + 1) * voxel_size;
+  const Column min_column = origin.unaryExpr([&](int v) { return floorDiv(v, vps); });
+  const Column max_column =
+      (origin + size).unaryExpr([&](int v) { return floorDiv(v - 1, vps); });
+  std::vector<const BlockT*> blocks(band.block_z_max - band.block_z_min + 1);
+  for (int cx = min_column.x(); cx <= max_column.x(); ++cx) {
+    for (int cy = min_column.y(); cy <= max_column.y(); ++cy) {
+      bool has_blocks = false;
+      for (size_t i = 0; i < blocks.size(); ++i) {
+        const auto block = layer.getBlockPtr(
+            spatial_hash::BlockIndex(cx, cy, band.block_z_min + static_cast<int>(i)));
+        blocks[i] = block.get();
+        has_blocks |= block != nullptr;
+      }
+
+      if (!has_blocks) {
+        continue;
+      }
+
+      for (int y = 0; y < vps; ++y) {
+        for (int x = 0; x < vps; ++x) {
+          const Column rel = Column(cx * vps + x, cy * vps + y) - origin;
+          if ((rel.array() < 0).any() || (rel.array() >= size.array()).any()) {
+            continue;
+          }
+
+          const size_t index = rel.y() * size.x() + rel.x();
+          bool gap = false;
+          for (int z = band.z_min; z <= band.z_max; ++z) {
+            const int block_z = floorDiv(z, vps);
+            const auto block = blocks[block_z - band.block_z_min];
+            if (!block) {
+              continue;
+            }
+
+            const auto& voxel = block->getVoxel(VoxelIndex(x, y, z - block_z * vps));
+            if (!isObserved(voxel, config.min_observation_weight)) {
+              continue;
+            }
+
+            const float voxel_z = (z + 0.5f) * voxel_size;
+            if (getDistance(voxel) > config.elevation_surface_distance) {
+              gap |= !std::isnan(ground[index]);
+              continue;
+            }
+
+            if (std::isnan(min_heights[index])) {
+              min_heights[index] = voxel_z;
+            }
+
+            max_heights[index] = voxel_z;
+            if (!gap) {
+              ground[index] = voxel_z;
+            } else if (std::isnan(clearance[index])) {
+              clearance[index] = voxel_z - ground[index] - voxel_size;
+            }
+          }
+
+          if (!std::isnan(ground[index]) && std::isnan(clearance[index])) {
+            clearance[index] = band_top - ground[index] - voxel_size / 2.0f;
+          }
+        }
+      }
+    }
+  }
+
+  // step heights are checked against the 4-connected neighbors with known ground
+  for (int r = 0; r < size.y(); ++r) {
+    for (int c = 0; c < size.x(); ++c) {
+      const size_t index = r * size.x() + c;
+      if (std::isnan(ground[index])) {
+        continue;
+      }
+
+      bool valid = clearance[index] >= config.robot_height;
+      const int neighbors[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+      for (const auto& offset : neighbors) {
+        const int nr = r + offset[0];
+        const int nc = c + offset[1];
+        if (!valid || nr < 0 || nc < 0 || nr >= size.y() || nc >= size.x()) {
+          continue;
+        }
+
+        const float other = ground[nr * size.x() + nc];
+        valid = std::isnan(other) ||
+                std::abs(other - ground[index]) <= config.max_step_height;
+      }
+
+      traversable[index] = valid ? 1.0f : 0.0f;
     }
   }
 }
 
-template <typename BlockT>
-void collate(const spatial_hash::VoxelLayer<BlockT>& layer_in,
-             spatial_hash::VoxelLayer<BlockT>& layer_out,
-             double min_observation_weight) {
-  for (const auto& block : layer_in) {
-    bool unobserved = true;
-    for (size_t i = 0; i < block.numVoxels(); ++i) {
-      if (isObserved(block.getVoxel(i), min_observation_weight)) {
-        unobserved = false;
-        break;
+}  // namespace
+
+template <typename LayerT>
+class LayerCollator {
+ public:
+  using BlockIndex = spatial_hash::BlockIndex;
+
+  explicit LayerCollator(const LayerT& input)
+      : layer_(input.voxel_size, input.voxels_per_side) {}
+
+  const LayerT& layer() const { return layer_; }
+
+  /**
+   * @brief Copy observed voxels from new or updated input blocks
+   *
+   * Collated blocks are flagged as updated only on the call that changed them. Blocks
+   * beyond the distance bound or past the block limit (least recently updated first)
+   * are dropped, where a bound of zero disables it. Dropped blocks are not collated
+   * again until the input flags them as updated. Every collated block is only checked
+   * against the distance bound after the sensor moves by a block.
+   */
+  void update(const LayerT& input,
+              const Eigen::Vector3d& sensor_position,
+              double min_observation_weight,
+              double max_distance,
+              size_t max_blocks) {
+    for (const auto& index : updated_) {
+      const auto block = layer_.getBlockPtr(index);
+      if (block) {
+        block->updated = false;
       }
     }
 
-    if (unobserved) {
-      continue;
+    updated_.clear();
+    const float half_size = layer_.blockSize() / 2.0f;
+    const auto too_far = [&](const auto& block) {
+      const Eigen::Vector3d center =
+          (block.origin() + Point::Constant(half_size)).template cast<double>();
+      return max_distance > 0.0 && (center - sensor_position).norm() > max_distance;
+    };
+
+    std::unordered_set<BlockIndex, IndexHash> unobserved;
+    std::unordered_set<BlockIndex, IndexHash> evicted;
+    for (const auto& block : input) {
+      if (!block.updated && evicted_.count(block.index)) {
+        evicted.insert(block.index);
+        continue;
+      }
+
+      auto iter = entries_.find(block.index);
+      const bool known = iter != entries_.end() || unobserved_.count(block.index);
+      if (known && !block.updated) {
+        if (iter == entries_.end()) {
+          unobserved.insert(block.index);
+        }
+
+        continue;
+      }
+
+      if (too_far(block)) {
+        if (iter != entries_.end()) {
+          remove(block.index);
+        }
+
+        evicted.insert(block.index);
+        continue;
+      }
+
+      bool observed = false;
+      for (size_t i = 0; i < block.numVoxels(); ++i) {
+        if (isObserved(block.getVoxel(i), min_observation_weight)) {
+          observed = true;
+          break;
+        }
+      }
+
+      if (!observed) {
+        if (iter == entries_.end()) {
+          unobserved.insert(block.index);
+        }
+
+        continue;
+      }
+
+      auto new_block = layer_.allocateBlockPtr(block.index);
+      new_block->updated = true;
+      for (size_t i = 0; i < block.numVoxels(); ++i) {
+        const auto& voxel = block.getVoxel(i);
+        if (isObserved(voxel, min_observation_weight)) {
+          new_block->getVoxel(i) = voxel;
+        }
+      }
+
+      updated_.push_back(block.index);
+      if (iter == entries_.end()) {
+        lru_.push_front(block.index);
+        entries_.emplace(block.index, lru_.begin());
+      } else {
+        lru_.splice(lru_.begin(), lru_, iter->second);
+      }
     }
 
-    auto new_block = layer_out.allocateBlockPtr(block.index);
-    new_block->updated = block.updated;
-    for (size_t i = 0; i < block.numVoxels(); ++i) {
-      const auto& voxel = block.getVoxel(i);
-      if (isObserved(voxel, min_observation_weight)) {
-        new_block->getVoxel(i) = voxel;
+    unobserved_.swap(unobserved);
+
+    // blocks collated above were checked already, so the rest can only be too far
+    // once the sensor moves
+    const bool moved = !last_check_position_ ||
+                       (*last_check_position_ - sensor_position).norm() >=
+                           layer_.blockSize();
+    if (max_distance > 0.0 && moved) {
+      last_check_position_ = sensor_position;
+      std::vector<BlockIndex> to_remove;
+      for (const auto& block : layer_) {
+        if (too_far(block)) {
+          to_remove.push_back(block.index);
+        }
+      }
+
+      for (const auto& index : to_remove) {
+        remove(index);
+        evicted.insert(index);
       }
     }
+
+    while (max_blocks > 0 && entries_.size() > max_blocks) {
+      evicted.insert(lru_.back());
+      remove(lru_.back());
+    }
+
+    evicted_.swap(evicted);
+  }
+
+ private:
+  // index is copied as it may refer to the erased list entry
+  void remove(BlockIndex index) {
+    auto iter = entries_.find(index);
+    if (iter != entries_.end()) {
+      lru_.erase(iter->second);
+      entries_.erase(iter);
+    }
+
+    layer_.removeBlock(index);
   }
-}
+
+  LayerT layer_;
+  //! Collated blocks ordered from most to least recently updated
+  std::list<BlockIndex> lru_;
+  std::unordered_map<BlockIndex, std::list<BlockIndex>::iterator, IndexHash> entries_;
+  //! Blocks flagged as updated by the last call
+  std::vector<BlockIndex> updated_;
+  //! Input blocks without observed voxels as of the last call
+  std::unordered_set<BlockIndex, IndexHash> unobserved_;
+  //! Input blocks dropped by the distance or block bounds and not updated since
+  std::unordered_set<BlockIndex, IndexHash> evicted_;
+  //! Sensor position when every collated block was last checked against the distance
+  std::optional<Eigen::Vector3d> last_check_position_;
+};
 
 void declare_config(OccupancyPublisher::Config& config) {
   using namespace config;
@@ -230,55 +604,330 @@ void declare_config(OccupancyPublisher::Config& config) {
   field(config.add_robot_footprint, "add_robot_footprint");
   field(config.footprint_min, "footprint_min");
   field(config.footprint_max, "footprint_max");
+  field(config.chunk_size, "chunk_size", "m");
+  field(config.publish_updates, "publish_updates");
+  field(config.num_threads, "num_threads");
+  field(config.window_width, "window_width", "m");
+  field(config.window_height, "window_height", "m");
+  check(config.chunk_size, GT, 0.0, "chunk_size");
+  check(config.window_width, GE, 0.0, "window_width");
+  check(config.window_height, GE, 0.0, "window_height");
+  field(config.publish_elevation, "publish_elevation");
+  field(config.elevation_min_height, "elevation_min_height", "m");
+  field(config.elevation_max_height, "elevation_max_height", "m");
+  field(config.elevation_surface_distance, "elevation_surface_distance", "m");
+  field(config.elevation_max_extent, "elevation_max_extent", "m");
+  field(config.robot_height, "robot_height", "m");
+  field(config.max_step_height, "max_step_height", "m");
+  check(config.elevation_max_extent, GT, 0.0, "elevation_max_extent");
+  checkCondition(config.elevation_max_height > config.elevation_min_height,
+                 "elevation_max_height must be above elevation_min_height");
 }
 
 OccupancyPublisher::OccupancyPublisher(const Config& config, const ros::NodeHandle& nh)
     : config(config::checkValid(config)),
       nh_(nh),
-      pub_(nh_.advertise<nav_msgs::OccupancyGrid>("occupancy", 1, true)) {}
+      state_(new State()),
+      pool_(new TaskPool(config.num_threads)) {
+  // subscribers only receive patches after the full grid, so resend it on connect
+  pub_ = nh_.advertise<nav_msgs::OccupancyGrid>(
+      "occupancy",
+      1,
+      [this](const ros::SingleSubscriberPublisher&) { state_->send_full = true; },
+      ros::SubscriberStatusCallback(),
+      ros::VoidConstPtr(),
+      true);
+  if (config.publish_updates) {
+    update_pub_ = nh_.advertise<map_msgs::OccupancyGridUpdate>(
+        "occupancy_updates",
+        1,
+        [this](const ros::SingleSubscriberPublisher&) {
+          state_->send_base_update = true;
+        });
+  }
+
+  if (config.publish_elevation) {
+    elevation_pub_ = nh_.advertise<hydra_msgs::ElevationMap>("elevation", 1, true);
+  }
+}
 
 OccupancyPublisher::~OccupancyPublisher() {}
 
 void OccupancyPublisher::publishTsdf(uint64_t timestamp_ns,
                                      const Eigen::Isometry3d& world_T_sensor,
                                      const TsdfLayer& tsdf) const {
-  if (pub_.getNumSubscribers() == 0) {
-    return;
-  }
-
-  nav_msgs::OccupancyGrid msg;
-  msg.header.frame_id = GlobalInfo::instance().getFrames().map;
-  msg.header.stamp.fromNSec(timestamp_ns);
-
-  msg.info.map_load_time = msg.header.stamp;
-
-  fillOccupancy(config, tsdf, world_T_sensor, msg);
-  pub_.publish(msg);
+  publishLayer(timestamp_ns, world_T_sensor, tsdf);
+  publishElevation(timestamp_ns, world_T_sensor, tsdf);
 }
 
 void OccupancyPublisher::publishGvd(uint64_t timestamp_ns,
                                     const Eigen::Isometry3d& world_T_sensor,
                                     const places::GvdLayer& gvd) const {
-  if (pub_.getNumSubscribers() == 0) {
+  publishLayer(timestamp_ns, world_T_sensor, gvd);
+  publishElevation(timestamp_ns, world_T_sensor, gvd);
+}
+
+template <typename BlockT>
+void OccupancyPublisher::publishElevation(
+    uint64_t timestamp_ns,
+    const Eigen::Isometry3d& world_T_sensor,
+    const spatial_hash::VoxelLayer<BlockT>& layer) const {
+  if (!config.publish_elevation || elevation_pub_.getNumSubscribers() == 0) {
     return;
   }
 
-  nav_msgs::OccupancyGrid msg;
+  const int vps = layer.voxels_per_side;
+  const Band band(
+      config, layer.voxel_size, vps, getSliceHeight(config, world_T_sensor));
+
+  // the map covers the same window as the occupancy grid or the blocks in the band
+  // (limited to the maximum extent around the robot)
+  const bool has_window = config.window_width > 0.0 && config.window_height > 0.0;
+  const Eigen::Vector2d window =
+      has_window ? Eigen::Vector2d(config.window_width, config.window_height)
+                 : Eigen::Vector2d::Constant(config.elevation_max_extent);
+  const Eigen::Vector2d position = world_T_sensor.translation().head<2>();
+  Column size = (window / layer.voxel_size).array().ceil().cast<int>().matrix();
+  Column origin =
+      (position / layer.voxel_size).array().floor().cast<int>().matrix() - size / 2;
+  if (!has_window) {
+    Column min_column = Column::Constant(std::numeric_limits<int>::max());
+    Column max_column = Column::Constant(std::numeric_limits<int>::lowest());
+    for (const auto& block : layer) {
+      const auto z = block.index.z();
+      if (z >= band.block_z_min && z <= band.block_z_max) {
+        const Column column(block.index.x(), block.index.y());
+        min_column = min_column.cwiseMin(column);
+        max_column = max_column.cwiseMax(column);
+      }
+    }
+
+    const Column lower = origin.cwiseMax(min_column * vps);
+    const Column upper = (origin + size).cwiseMin((max_column + Column::Ones()) * vps);
+    if ((upper.array() <= lower.array()).any()) {
+      return;
+    }
+
+    origin = lower;
+    size = upper - lower;
+  }
+
+  auto& msg = state_->elevation;
   msg.header.frame_id = GlobalInfo::instance().getFrames().map;
   msg.header.stamp.fromNSec(timestamp_ns);
+  fillElevation(config, layer, band, origin, size, msg);
+  elevation_pub_.publish(msg);
+}
 
-  msg.info.map_load_time = msg.header.stamp;
+template <typename BlockT>
+void OccupancyPublisher::publishLayer(
+    uint64_t timestamp_ns,
+    const Eigen::Isometry3d& world_T_sensor,
+    const spatial_hash::VoxelLayer<BlockT>& layer) const {
+  auto& state = *state_;
+  if (pub_.getNumSubscribers() == 0 && update_pub_.getNumSubscribers() == 0) {
+    // block update flags are not tracked without subscribers
+    state.valid = false;
+    return;
+  }
 
-  fillOccupancy(config, gvd, world_T_sensor, msg);
-  pub_.publish(msg);
+  const auto height = getSliceHeight(config, world_T_sensor);
+  std::vector<SliceKey> slices;
+  for (size_t i = 0; i < config.num_slices; ++i) {
+    const Point slice_pos(0, 0, height + i * layer.voxel_size);
+    const auto key = layer.getVoxelKey(slice_pos);
+    slices.emplace_back(key.first.z(), key.second.z());
+  }
+
+  const int voxels_per_side = layer.voxels_per_side;
+  const Eigen::Vector2d position = world_T_sensor.translation().head<2>();
+  const bool rolling = config.window_width > 0.0 && config.window_height > 0.0;
+  // without updates, the full grid is sent every time like before
+  bool send_full = state.send_full.exchange(false) || !config.publish_updates;
+  if (!state.valid || slices != state.slices || state.voxel_size != layer.voxel_size ||
+      state.voxels_per_side != voxels_per_side || state.rolling != rolling) {
+    state.reset();
+    state.slices = slices;
+    state.voxel_size = layer.voxel_size;
+    state.voxels_per_side = voxels_per_side;
+    state.msg.info.resolution = layer.voxel_size;
+    state.msg.info.origin.position.z = height;
+    state.msg.info.origin.orientation.w = 1.0;
+    if (rolling) {
+      const Eigen::Vector2d window(config.window_width, config.window_height);
+      state.initWindow((window / layer.voxel_size).array().ceil().cast<int>().matrix(),
+                       position);
+    }
+
+    send_full = true;
+  }
+
+  const Column old_origin = state.origin;
+  const bool moved = rolling && state.recenter(position);
+
+  // collect the columns whose slice blocks are new or changed
+  ColumnSet columns;
+  ColumnSet dirty;
+  const auto add_block = [&](const BlockT& block) {
+    const Column column(block.index.x(), block.index.y());
+    columns.insert(column);
+    if (!state.valid || block.updated || !state.columns.count(column) ||
+        (moved && state.newlyVisible(column, old_origin))) {
+      dirty.insert(column);
+    }
+  };
+
+  if (rolling) {
+    // only the blocks under the window are visited, so the cost is independent of
+    // the size of the layer
+    std::vector<int> block_zs;
+    for (const auto& key : slices) {
+      if (std::find(block_zs.begin(), block_zs.end(), key.first) == block_zs.end()) {
+        block_zs.push_back(key.first);
+      }
+    }
+
+    const Column min_column = state.origin.unaryExpr(
+        [&](int v) { return floorDiv(v, voxels_per_side); });
+    const Column max_column = (state.origin + state.size).unaryExpr(
+        [&](int v) { return floorDiv(v - 1, voxels_per_side); });
+    for (int x = min_column.x(); x <= max_column.x(); ++x) {
+      for (int y = min_column.y(); y <= max_column.y(); ++y) {
+        for (const auto z : block_zs) {
+          const auto block = layer.getBlockPtr(spatial_hash::BlockIndex(x, y, z));
+          if (block) {
+            add_block(*block);
+          }
+        }
+      }
+    }
+  } else {
+    for (const auto& block : layer) {
+      const auto z = block.index.z();
+      if (std::any_of(slices.begin(), slices.end(), [z](const SliceKey& key) {
+            return key.first == z;
+          })) {
+        add_block(block);
+      }
+    }
+  }
+
+  // footprint clearing depends on the current pose, so the old and new footprint
+  // columns are both recomputed
+  auto footprint = getFootprintColumns(config, world_T_sensor, layer.blockSize());
+  for (const auto& column : state.footprint_columns) {
+    dirty.insert(column);
+  }
+
+  for (const auto& column : footprint) {
+    dirty.insert(column);
+  }
+
+  if (!rolling) {
+    Column needed_min = Column::Constant(std::numeric_limits<int>::max());
+    Column needed_max = Column::Constant(std::numeric_limits<int>::lowest());
+    for (const auto& column : dirty) {
+      if (columns.count(column)) {
+        needed_min = needed_min.cwiseMin(column);
+        needed_max = needed_max.cwiseMax(column);
+      }
+    }
+
+    const int chunk = std::max(
+        1, static_cast<int>(std::ceil(config.chunk_size / layer.blockSize())));
+    if ((needed_max.array() >= needed_min.array()).all()) {
+      send_full |= state.grow(needed_min, needed_max, chunk);
+    }
+  }
+
+  CellGrid::Bounds changed;
+  std::vector<Column> to_fill;
+  for (const auto& column : dirty) {
+    if (!state.overlaps(column)) {
+      continue;
+    }
+
+    if (columns.count(column)) {
+      to_fill.push_back(column);
+    } else {
+      clearColumn(column, state);  // blocks were removed from the layer
+    }
+
+    changed.add(state, column);
+  }
+
+  // each task fills an interleaved subset of the columns
+  const Eigen::Isometry3f sensor_T_world = world_T_sensor.inverse().cast<float>();
+  const size_t num_tasks = std::min(pool_->numThreads() + 1, to_fill.size());
+  std::vector<TaskPool::Task> tasks;
+  for (size_t t = 0; t < num_tasks; ++t) {
+    tasks.push_back([&, t]() {
+      for (size_t i = t; i < to_fill.size(); i += num_tasks) {
+        const auto& column = to_fill[i];
+        const bool in_footprint = footprint.count(column);
+        fillColumn(config, layer, sensor_T_world, in_footprint, column, state);
+      }
+    });
+  }
+
+  pool_->run(tasks);
+
+  // columns that lost all of their slice blocks also need to be cleared
+  for (const auto& column : state.columns) {
+    if (!columns.count(column) && !dirty.count(column) && state.overlaps(column)) {
+      clearColumn(column, state);
+      changed.add(state, column);
+    }
+  }
+
+  state.columns.swap(columns);
+  state.footprint_columns.swap(footprint);
+  state.valid = true;
+
+  if (rolling) {
+    // the window origin moves with the robot, so the whole window is always sent
+    send_full |= moved || !changed.empty();
+    if (send_full) {
+      state.unwrap();
+    }
+  }
+
+  std_msgs::Header header;
+  header.frame_id = GlobalInfo::instance().getFrames().map;
+  header.stamp.fromNSec(timestamp_ns);
+  if (send_full) {
+    publishGrid(pub_, header, state);
+  }
+
+  if (state.size.prod() > 0 && state.send_base_update.exchange(false)) {
+    // subscribers to only the updates get the whole grid as their first patch
+    changed.min = Column::Zero();
+    changed.max = state.size - Column::Ones();
+  } else if (send_full) {
+    return;  // the full grid already contains the changes
+  }
+
+  if (changed.empty()) {
+    return;
+  }
+
+  map_msgs::OccupancyGridUpdate msg;
+  msg.header = header;
+  fillUpdate(state, changed, msg);
+  update_pub_.publish(msg);
 }
 
 TsdfOccupancyPublisher::TsdfOccupancyPublisher(const Config& config)
     : config(config),
       pub_(OccupancyPublisher(config.extraction, ros::NodeHandle(config.ns))) {}
 
+TsdfOccupancyPublisher::~TsdfOccupancyPublisher() {}
+
 GvdOccupancyPublisher::GvdOccupancyPublisher(const Config& config)
-    : pub_(OccupancyPublisher(config.extraction, ros::NodeHandle(config.ns))) {}
+    : config(config),
+      pub_(OccupancyPublisher(config.extraction, ros::NodeHandle(config.ns))) {}
+
+GvdOccupancyPublisher::~GvdOccupancyPublisher() {}
 
 void TsdfOccupancyPublisher::call(uint64_t timestamp_ns,
                                   const Eigen::Isometry3d& world_T_sensor,
@@ -289,12 +938,16 @@ void TsdfOccupancyPublisher::call(uint64_t timestamp_ns,
     return;
   }
 
-  if (!tsdf_) {
-    tsdf_.reset(new TsdfLayer(tsdf.voxel_size, tsdf.voxels_per_side));
+  if (!collator_) {
+    collator_.reset(new LayerCollator<TsdfLayer>(tsdf));
   }
 
-  collate(tsdf, *tsdf_, config.extraction.min_observation_weight);
-  pub_.publishTsdf(timestamp_ns, world_T_sensor, *tsdf_);
+  collator_->update(tsdf,
+                    world_T_sensor.translation(),
+                    config.extraction.min_observation_weight,
+                    config.max_collated_distance,
+                    config.max_collated_blocks);
+  pub_.publishTsdf(timestamp_ns, world_T_sensor, collator_->layer());
 }
 
 void GvdOccupancyPublisher::call(uint64_t timestamp_ns,
@@ -306,12 +959,16 @@ void GvdOccupancyPublisher::call(uint64_t timestamp_ns,
     return;
   }
 
-  if (!gvd_) {
-    gvd_.reset(new places::GvdLayer(gvd.voxel_size, gvd.voxels_per_side));
+  if (!collator_) {
+    collator_.reset(new LayerCollator<places::GvdLayer>(gvd));
   }
 
-  collate(gvd, *gvd_, config.extraction.min_observation_weight);
-  pub_.publishGvd(timestamp_ns, world_T_body.cast<double>(), *gvd_);
+  collator_->update(gvd,
+                    world_T_body.translation().cast<double>(),
+                    config.extraction.min_observation_weight,
+                    config.max_collated_distance,
+                    config.max_collated_blocks);
+  pub_.publishGvd(timestamp_ns, world_T_body.cast<double>(), collator_->layer());
 }
 
 void declare_config(GvdOccupancyPublisher::Config& config) {
@@ -320,6 +977,9 @@ void declare_config(GvdOccupancyPublisher::Config& config) {
   field(config.ns, "ns");
   field(config.extraction, "extraction");
   field(config.collate, "collate");
+  field(config.max_collated_distance, "max_collated_distance", "m");
+  field(config.max_collated_blocks, "max_collated_blocks");
+  check(config.max_collated_distance, GE, 0.0, "max_collated_distance");
 }
 
 void declare_config(TsdfOccupancyPublisher::Config& config) {
@@ -328,6 +988,9 @@ void declare_config(TsdfOccupancyPublisher::Config& config) {
   field(config.ns, "ns");
   field(config.extraction, "extraction");
   field(config.collate, "collate");
+  field(config.max_collated_distance, "max_collated_distance", "m");
+  field(config.max_collated_blocks, "max_collated_blocks");
+  check(config.max_collated_distance, GE, 0.0, "max_collated_distance");
 }
 
 }  // namespace hydra
@@ -0,0 +1,305 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include "hydra_ros/utils/shared_memory_ring.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+
+namespace hydra {
+
+namespace {
+
+inline constexpr uint64_t RING_MAGIC = 0x6864736773686d31;  // "hdsgshm1"
+
+inline size_t alignUp(size_t size) { return (size + 63) & ~static_cast<size_t>(63); }
+
+// steady clock is CLOCK_MONOTONIC on linux, which is shared between processes
+inline int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+struct SharedMemoryRing::Header {
+  std::atomic<uint64_t> magic;
+  uint64_t num_slots;
+  uint64_t slot_capacity;
+  uint64_t instance_id;
+  std::atomic<uint64_t> next_slot;
+};
+
+struct SharedMemoryRing::SlotHeader {
+  std::atomic<uint64_t> version;
+  std::atomic<uint32_t> readers;
+  // time the reader count last went from zero to one
+  std::atomic<int64_t> busy_since_ns;
+  uint64_t size;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory ring requires lock-free 64-bit atomics");
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name,
+                                   void* data,
+                                   size_t size,
+                                   bool owner)
+    : name_(name), data_(data), size_(size), owner_(owner), reader_timeout_ns_(0) {}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  munmap(data_, size_);
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+SharedMemoryRing::Ptr SharedMemoryRing::create(const std::string& name,
+                                               size_t num_slots,
+                                               size_t slot_capacity,
+                                               double reader_timeout_s) {
+  CHECK_GT(num_slots, 0u) << "shared memory ring requires at least one slot";
+  CHECK_GT(reader_timeout_s, 0.0) << "reader timeout must be positive";
+  const size_t slot_size = alignUp(sizeof(SlotHeader)) + alignUp(slot_capacity);
+  const size_t total_size = alignUp(sizeof(Header)) + num_slots * slot_size;
+
+  // replace any stale segment left behind by a previous run
+  shm_unlink(name.c_str());
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to create shared memory segment " << name << ": "
+               << std::strerror(errno);
+    return nullptr;
+  }
+
+  if (ftruncate(fd, total_size) != 0) {
+    LOG(ERROR) << "Failed to size shared memory segment " << name << ": "
+               << std::strerror(errno);
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  void* data = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map shared memory segment " << name << ": "
+               << std::strerror(errno);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  Ptr ring(new SharedMemoryRing(name, data, total_size, true));
+  ring->reader_timeout_ns_ = static_cast<int64_t>(reader_timeout_s * 1.0e9);
+  auto header = new (data) Header();
+  header->num_slots = num_slots;
+  header->slot_capacity = alignUp(slot_capacity);
+  header->instance_id = std::chrono::steady_clock::now().time_since_epoch().count();
+  header->next_slot = 0;
+  for (size_t i = 0; i < num_slots; ++i) {
+    auto slot = new (ring->slot(i)) SlotHeader();
+    slot->version = 0;
+    slot->readers = 0;
+    slot->busy_since_ns = 0;
+    slot->size = 0;
+  }
+
+  // publish the magic last so readers never see a partially initialized segment
+  header->magic.store(RING_MAGIC, std::memory_order_release);
+  return ring;
+}
+
+SharedMemoryRing::Ptr SharedMemoryRing::open(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    VLOG(1) << "Failed to open shared memory segment " << name << ": "
+            << std::strerror(errno);
+    return nullptr;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+    LOG(ERROR) << "Shared memory segment " << name << " is invalid";
+    close(fd);
+    return nullptr;
+  }
+
+  const size_t total_size = info.st_size;
+  // readers need write access for the per-slot reader counts
+  void* data = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map shared memory segment " << name << ": "
+               << std::strerror(errno);
+    return nullptr;
+  }
+
+  Ptr ring(new SharedMemoryRing(name, data, total_size, false));
+  const auto header = static_cast<const Header*>(data);
+  if (header->magic.load(std::memory_order_acquire) != RING_MAGIC) {
+    LOG(ERROR) << "Shared memory segment " << name << " is not a valid ring";
+    return nullptr;
+  }
+
+  const size_t slot_size = alignUp(sizeof(SlotHeader)) + header->slot_capacity;
+  if (total_size < alignUp(sizeof(Header)) + header->num_slots * slot_size) {
+    LOG(ERROR) << "Shared memory segment " << name << " is not a valid ring";
+    return nullptr;
+  }
+
+  return ring;
+}
+
+std::string SharedMemoryRing::segmentName(const std::string& name) {
+  std::string segment = "/hydra";
+  for (const auto c : name) {
+    segment.push_back(std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+  }
+
+  return segment;
+}
+
+std::optional<SharedMemoryRing::Token> SharedMemoryRing::write(const uint8_t* data,
+                                                                size_t size) {
+  auto header = static_cast<Header*>(data_);
+  if (size > header->slot_capacity) {
+    return std::nullopt;
+  }
+
+  const uint64_t start = header->next_slot.load();
+  for (uint64_t i = 0; i < header->num_slots; ++i) {
+    const uint32_t index = (start + i) % header->num_slots;
+    auto slot_header = slot(index);
+
+    // mark the slot as being written before checking for readers: any reader that
+    // registers afterwards sees the odd version and backs off
+    const uint64_t prev_version = slot_header->version.load();
+    slot_header->version.store(prev_version + 1);
+    if (slot_header->readers.load() > 0 && !reclaimSlot(*slot_header, index)) {
+      slot_header->version.store(prev_version);
+      continue;
+    }
+
+    auto slot_data =
+        reinterpret_cast<uint8_t*>(slot_header) + alignUp(sizeof(SlotHeader));
+    std::memcpy(slot_data, data, size);
+    slot_header->size = size;
+    slot_header->version.store(prev_version + 2);
+    header->next_slot.store((index + 1) % header->num_slots);
+    return Token{index, prev_version + 2};
+  }
+
+  return std::nullopt;
+}
+
+bool SharedMemoryRing::read(const Token& token, const ReadCallback& callback) const {
+  const auto header = static_cast<const Header*>(data_);
+  if (token.slot >= header->num_slots) {
+    return false;
+  }
+
+  auto slot_header = slot(token.slot);
+  // the count may have been reset by a reclaim, so never decrement past zero
+  const auto release = [slot_header]() {
+    uint32_t readers = slot_header->readers.load();
+    while (readers > 0 &&
+           !slot_header->readers.compare_exchange_weak(readers, readers - 1)) {
+    }
+  };
+
+  if (slot_header->readers.fetch_add(1) == 0) {
+    slot_header->busy_since_ns.store(nowNs());
+  }
+
+  if (slot_header->version.load() != token.version) {
+    release();
+    return false;
+  }
+
+  const auto slot_data =
+      reinterpret_cast<const uint8_t*>(slot_header) + alignUp(sizeof(SlotHeader));
+  try {
+    callback(slot_data, slot_header->size);
+  } catch (...) {
+    release();
+    throw;
+  }
+
+  release();
+  // the slot was reclaimed while the callback ran
+  return slot_header->version.load() == token.version;
+}
+
+size_t SharedMemoryRing::numSlots() const {
+  return static_cast<const Header*>(data_)->num_slots;
+}
+
+uint64_t SharedMemoryRing::instanceId() const {
+  return static_cast<const Header*>(data_)->instance_id;
+}
+
+size_t SharedMemoryRing::slotCapacity() const {
+  return static_cast<const Header*>(data_)->slot_capacity;
+}
+
+bool SharedMemoryRing::reclaimSlot(SlotHeader& slot_header, size_t index) const {
+  const int64_t busy_ns = nowNs() - slot_header.busy_since_ns.load();
+  if (busy_ns < reader_timeout_ns_) {
+    return false;
+  }
+
+  LOG(WARNING) << "Reclaiming slot " << index << " of " << name_ << " from "
+               << slot_header.readers.load() << " reader(s) busy for "
+               << busy_ns * 1.0e-9 << " s";
+  slot_header.readers.store(0);
+  return true;
+}
+
+SharedMemoryRing::SlotHeader* SharedMemoryRing::slot(size_t index) const {
+  const auto header = static_cast<const Header*>(data_);
+  const size_t slot_size = alignUp(sizeof(SlotHeader)) + header->slot_capacity;
+  const size_t offset = alignUp(sizeof(Header)) + index * slot_size;
+  return reinterpret_cast<SlotHeader*>(static_cast<uint8_t*>(data_) + offset);
+}
+
+}  // namespace hydra
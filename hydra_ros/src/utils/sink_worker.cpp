@@ -0,0 +1,116 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include "hydra_ros/utils/sink_worker.h"
+
+#include <glog/logging.h>
+
+namespace hydra {
+
+SinkWorker::SinkWorker(const std::string& name, size_t max_pending)
+    : name_(name),
+      max_pending_(max_pending),
+      busy_(false),
+      should_shutdown_(false),
+      num_dropped_(0) {
+  thread_ = std::thread(&SinkWorker::spin, this);
+}
+
+SinkWorker::~SinkWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    should_shutdown_ = true;
+  }
+
+  job_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  if (num_dropped_) {
+    VLOG(1) << "[" << name_ << "] dropped " << num_dropped_ << " stale job(s)";
+  }
+}
+
+void SinkWorker::push(Job&& job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (max_pending_ && jobs_.size() >= max_pending_) {
+      jobs_.pop_front();
+      ++num_dropped_;
+    }
+
+    jobs_.push_back(std::move(job));
+  }
+
+  job_cv_.notify_one();
+}
+
+void SinkWorker::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+void SinkWorker::spin() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_cv_.wait(lock, [this] { return should_shutdown_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        // only exit once every queued job has run
+        break;
+      }
+
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      busy_ = true;
+    }
+
+    try {
+      job();
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "[" << name_ << "] job failed: " << e.what();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_ = false;
+    }
+
+    done_cv_.notify_all();
+  }
+}
+
+}  // namespace hydra
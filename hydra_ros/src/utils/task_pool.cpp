@@ -0,0 +1,146 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include "hydra_ros/utils/task_pool.h"
+
+namespace hydra {
+
+TaskPool::TaskPool(size_t num_threads)
+    : tasks_(nullptr),
+      next_task_(0),
+      num_remaining_(0),
+      should_shutdown_(false) {
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&TaskPool::spin, this);
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    should_shutdown_ = true;
+  }
+
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void TaskPool::run(const std::vector<Task>& tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+
+  if (threads_.empty()) {
+    for (const auto& task : tasks) {
+      task();
+    }
+
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_ = &tasks;
+    next_task_ = 0;
+    num_remaining_ = tasks.size();
+    error_ = nullptr;
+  }
+
+  work_cv_.notify_all();
+  while (runNext()) {
+  }
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return num_remaining_ == 0; });
+    tasks_ = nullptr;
+    error = error_;
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool TaskPool::runNext() {
+  const Task* task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!tasks_ || next_task_ >= tasks_->size()) {
+      return false;
+    }
+
+    task = &(*tasks_)[next_task_];
+    ++next_task_;
+  }
+
+  try {
+    (*task)();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+      error_ = std::current_exception();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--num_remaining_ == 0) {
+    done_cv_.notify_all();
+  }
+
+  return true;
+}
+
+void TaskPool::spin() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this] {
+        return should_shutdown_ || (tasks_ && next_task_ < tasks_->size());
+      });
+
+      if (should_shutdown_) {
+        return;
+      }
+    }
+
+    while (runNext()) {
+    }
+  }
+}
+
+}  // namespace hydra
@@ -49,6 +49,7 @@ ConfigManager::~ConfigManager() {
 }
 
 void ConfigManager::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
   visualizer_config_ = std::make_shared<ConfigWrapper<VisualizerConfig>>(nh_, "config");
   layer_configs_.clear();
   dynamic_layer_configs_.clear();
@@ -57,6 +58,8 @@ void ConfigManager::reset() {
 
 void ConfigManager::reset(const DynamicSceneGraph& graph) {
   reset();
+
+  std::lock_guard<std::mutex> lock(mutex_);
   for (const auto layer : graph.layer_ids) {
     const auto ns = "config/layer" + std::to_string(layer);
     layer_configs_.emplace(layer,
@@ -72,6 +75,7 @@ void ConfigManager::reset(const DynamicSceneGraph& graph) {
 }
 
 bool ConfigManager::hasChange() const {
+  std::lock_guard<std::mutex> lock(mutex_);
   bool has_changed = visualizer_config_->hasChange();
 
   for (const auto& id_config_pair : layer_configs_) {
@@ -90,6 +94,7 @@ bool ConfigManager::hasChange() const {
 }
 
 void ConfigManager::clearChangeFlags() {
+  std::lock_guard<std::mutex> lock(mutex_);
   visualizer_config_->clearChangeFlag();
   for (auto& id_config_pair : layer_configs_) {
     id_config_pair.second->clearChangeFlag();
@@ -105,6 +110,7 @@ void ConfigManager::clearChangeFlags() {
 }
 
 const VisualizerConfig& ConfigManager::getVisualizerConfig() const {
+  std::lock_guard<std::mutex> lock(mutex_);
   if (!visualizer_config_) {
     visualizer_config_ =
         std::make_shared<ConfigWrapper<VisualizerConfig>>(nh_, "config");
@@ -114,6 +120,7 @@ const VisualizerConfig& ConfigManager::getVisualizerConfig() const {
 }
 
 const LayerConfig* ConfigManager::getLayerConfig(LayerId layer) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto iter = layer_configs_.find(layer);
   if (iter == layer_configs_.end()) {
     const auto ns = "config/layer" + std::to_string(layer);
@@ -126,6 +133,7 @@ const LayerConfig* ConfigManager::getLayerConfig(LayerId layer) const {
 }
 
 const DynamicLayerConfig& ConfigManager::getDynamicLayerConfig(LayerId layer) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto iter = dynamic_layer_configs_.find(layer);
   if (iter == dynamic_layer_configs_.end()) {
     const std::string ns = "config/dynamic_layer/" + std::to_string(layer);
@@ -139,6 +147,7 @@ const DynamicLayerConfig& ConfigManager::getDynamicLayerConfig(LayerId layer) co
 }
 
 const ColormapConfig& ConfigManager::getColormapConfig(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto iter = colormaps_.find(name);
   if (iter == colormaps_.end()) {
     const std::string ns = "config/" + name;
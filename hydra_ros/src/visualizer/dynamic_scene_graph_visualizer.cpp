@@ -38,6 +38,9 @@
 #include <spark_dsg/node_attributes.h>
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <algorithm>
+#include <iterator>
+
 #include "hydra_ros/visualizer/colormap_utilities.h"
 #include "hydra_ros/visualizer/visualizer_utilities.h"
 
@@ -57,6 +60,14 @@ enum class NodeColorMode : int {
   FRONTIER = hydra_ros::LayerVisualizer_FRONTIER
 };
 
+// moves the points and colors of a reused marker out while keeping its namespace,
+// which is still needed to look up the active namespaces
+Marker takeMarker(Marker& marker) {
+  Marker taken = std::move(marker);
+  marker.ns = taken.ns;
+  return taken;
+}
+
 void clearPrevMarkers(const std_msgs::Header& header,
                       const std::set<NodeId>& curr_nodes,
                       const std::string& ns,
@@ -74,16 +85,47 @@ void clearPrevMarkers(const std_msgs::Header& header,
   prev_nodes = curr_nodes;
 }
 
+MarkerArray& DynamicSceneGraphVisualizer::MarkerGroups::operator[](
+    const std::string& name) {
+  for (auto& [group, msg] : entries) {
+    if (group == name) {
+      return msg;
+    }
+  }
+
+  return entries.emplace_back(name, MarkerArray()).second;
+}
+
 DynamicSceneGraphVisualizer::DynamicSceneGraphVisualizer(const ros::NodeHandle& nh)
-    : nh_(nh), need_redraw_(false), periodic_redraw_(false), visualizer_frame_("map") {
+    : nh_(nh),
+      need_redraw_(false),
+      periodic_redraw_(false),
+      config_changed_(false),
+      redraw_all_(false),
+      separate_layer_topics_(false),
+      visualizer_frame_("map") {
   nh_.param("visualizer_frame", visualizer_frame_, visualizer_frame_);
+  // each layer and edge group gets its own latched topic under dsg_markers
+  nh_.param("separate_layer_topics", separate_layer_topics_, separate_layer_topics_);
 
   std::string config_ns = "~";
   nh_.param("config_ns", config_ns, config_ns);
   config_manager_ = std::make_shared<ConfigManager>(ros::NodeHandle(config_ns));
 
-  dsg_pub_ = nh_.advertise<MarkerArray>("dsg_markers", 1, true);
+  // only changed layers are published, so new subscribers trigger a full redraw
+  dsg_pub_ = nh_.advertise<MarkerArray>(
+      "dsg_markers",
+      1,
+      [this](const ros::SingleSubscriberPublisher& pub) { handleNewSubscriber(pub); },
+      ros::SubscriberStatusCallback(),
+      ros::VoidConstPtr(),
+      true);
   dynamic_layers_viz_pub_ = nh_.advertise<MarkerArray>("dynamic_layers_viz", 1, true);
+
+  // layers, edges and plugins are drawn in parallel (0 draws everything in order)
+  int num_draw_threads = 3;
+  nh_.param("num_draw_threads", num_draw_threads, num_draw_threads);
+  draw_pool_.reset(new TaskPool(std::max(num_draw_threads, 0)));
 }
 
 void DynamicSceneGraphVisualizer::start(bool periodic_redraw) {
@@ -105,11 +147,27 @@ void DynamicSceneGraphVisualizer::reset() {
     MarkerArray msg;
     resetImpl(header, msg);
 
-    if (!msg.markers.empty()) {
+    if (separate_layer_topics_) {
+      // deletes have to go out on the topic that added the marker
+      MarkerGroups groups;
+      for (const auto& marker : msg.markers) {
+        auto iter = namespace_groups_.find(marker.ns);
+        if (iter != namespace_groups_.end()) {
+          groups[iter->second].markers.push_back(marker);
+        }
+      }
+
+      publishGroups(groups);
+    } else if (!msg.markers.empty()) {
       dsg_pub_.publish(msg);
     }
   }
 
+  namespace_groups_.clear();
+
+  layer_cache_.clear();
+  interlayer_edge_cache_.reset();
+  mesh_edges_hash_ = 0;
   scene_graph_.reset();
 }
 
@@ -118,7 +176,8 @@ bool DynamicSceneGraphVisualizer::redraw() {
     return false;
   }
 
-  need_redraw_ |= config_manager_->hasChange();
+  config_changed_ |= config_manager_->hasChange();
+  need_redraw_ |= config_changed_;
   for (const auto& plugin : plugins_) {
     need_redraw_ |= plugin->hasChange();
   }
@@ -133,21 +192,70 @@ bool DynamicSceneGraphVisualizer::redraw() {
   header.stamp = ros::Time::now();
   header.frame_id = visualizer_frame_;
 
-  MarkerArray msg;
-  redrawImpl(header, msg);
-
-  if (!msg.markers.empty()) {
-    dsg_pub_.publish(msg);
-  }
+  MarkerGroups groups;
+  redrawImpl(header, groups);
+  publishGroups(groups);
 
   config_manager_->clearChangeFlags();
   for (auto& plugin : plugins_) {
     plugin->clearChangeFlag();
   }
 
+  config_changed_ = false;
+  redraw_all_ = false;
   return true;
 }
 
+void DynamicSceneGraphVisualizer::publishGroups(MarkerGroups& groups) {
+  if (!separate_layer_topics_) {
+    size_t num_markers = 0;
+    for (const auto& name_msg_pair : groups) {
+      num_markers += name_msg_pair.second.markers.size();
+    }
+
+    MarkerArray msg;
+    msg.markers.reserve(num_markers);
+    for (auto& name_msg_pair : groups.entries) {
+      auto& markers = name_msg_pair.second.markers;
+      std::move(markers.begin(), markers.end(), std::back_inserter(msg.markers));
+      markers.clear();
+    }
+
+    if (!msg.markers.empty()) {
+      dsg_pub_.publish(msg);
+    }
+
+    return;
+  }
+
+  // unchanged groups have no markers, so only the topics that changed are published
+  for (const auto& [name, msg] : groups) {
+    if (msg.markers.empty()) {
+      continue;
+    }
+
+    auto iter = group_pubs_.find(name);
+    if (iter == group_pubs_.end()) {
+      auto pub = nh_.advertise<MarkerArray>(
+          "dsg_markers/" + name,
+          1,
+          [this](const ros::SingleSubscriberPublisher& s) { handleNewSubscriber(s); },
+          ros::SubscriberStatusCallback(),
+          ros::VoidConstPtr(),
+          true);
+      iter = group_pubs_.emplace(name, pub).first;
+    }
+
+    for (const auto& marker : msg.markers) {
+      if (marker.action == Marker::ADD) {
+        namespace_groups_[marker.ns] = name;
+      }
+    }
+
+    iter->second.publish(msg);
+  }
+}
+
 void DynamicSceneGraphVisualizer::setGraph(const DynamicSceneGraph::Ptr& scene_graph,
                                            bool need_reset) {
   if (scene_graph == nullptr) {
@@ -175,6 +283,7 @@ void DynamicSceneGraphVisualizer::setGraph(const DynamicSceneGraph::Ptr& scene_g
 void DynamicSceneGraphVisualizer::setLayerColorFunction(LayerId layer,
                                                         const ColorFunction& func) {
   layer_colors_[layer] = func;
+  layer_cache_.erase(layer);
 }
 
 inline double getDynamicHue(const DynamicLayerConfig& config, char prefix) {
@@ -209,7 +318,7 @@ void DynamicSceneGraphVisualizer::drawDynamicLayer(const std_msgs::Header& heade
                                             getNodeColor(config, layer.prefix),
                                             node_ns,
                                             viz_idx);
-  addMultiMarkerIfValid(nodes, msg);
+  addMultiMarkerIfValid(std::move(nodes), msg);
 
   const std::string edge_ns = getDynamicEdgeNamespace(layer.prefix);
   Marker edges = makeDynamicEdgeMarkers(header,
@@ -219,7 +328,7 @@ void DynamicSceneGraphVisualizer::drawDynamicLayer(const std_msgs::Header& heade
                                         getEdgeColor(config, layer.prefix),
                                         edge_ns,
                                         viz_idx);
-  addMultiMarkerIfValid(edges, msg);
+  addMultiMarkerIfValid(std::move(edges), msg);
 
   if (layer.numNodes() == 0) {
     deleteLabel(header, layer.prefix, msg);
@@ -229,7 +338,7 @@ void DynamicSceneGraphVisualizer::drawDynamicLayer(const std_msgs::Header& heade
   const std::string label_ns = getDynamicLabelNamespace(layer.prefix);
   Marker label =
       makeDynamicLabelMarker(header, config, layer, viz_config, label_ns, viz_idx);
-  msg.markers.push_back(label);
+  msg.markers.push_back(std::move(label));
   published_dynamic_labels_.insert(label_ns);
 }
 
@@ -317,13 +426,38 @@ void DynamicSceneGraphVisualizer::resetImpl(const std_msgs::Header& header,
 }
 
 void DynamicSceneGraphVisualizer::redrawImpl(const std_msgs::Header& header,
-                                             MarkerArray& msg) {
+                                             MarkerGroups& groups) {
   // this is janky, figure out how to do this better
   for (const auto& callback : callbacks_) {
     callback(scene_graph_);
   }
 
+  // configs are loaded lazily, so every config is loaded before drawing in parallel
   const auto& visualizer_config = config_manager_->getVisualizerConfig();
+  config_manager_->getColormapConfig("places_colormap");
+
+  std::map<LayerId, LayerConfig> all_configs;
+  for (const auto layer_id : scene_graph_->layer_ids) {
+    all_configs[layer_id] = *CHECK_NOTNULL(config_manager_->getLayerConfig(layer_id));
+  }
+
+  std::map<LayerId, DynamicLayerConfig> all_dynamic_configs;
+  for (const auto& id_layer_pair : scene_graph_->dynamicLayers()) {
+    const auto layer_id = id_layer_pair.first;
+    all_dynamic_configs[layer_id] = config_manager_->getDynamicLayerConfig(layer_id);
+  }
+
+  struct LayerDraw {
+    const SceneGraphLayer* layer;
+    const LayerConfig* config;
+    MarkerCache* cache;
+    MarkerArray* msg;
+    bool changed = false;
+  };
+
+  bool layers_changed = config_changed_;
+  std::vector<LayerDraw> layer_draws;
+  // groups are added in layer order so that merged markers keep the same order
   for (auto&& [layer_id, layer] : scene_graph_->layers()) {
     const auto layer_config = config_manager_->getLayerConfig(layer_id);
     if (!layer_config) {
@@ -331,32 +465,100 @@ void DynamicSceneGraphVisualizer::redrawImpl(const std_msgs::Header& header,
     }
 
     if (!layer_config->visualize) {
-      deleteLayer(header, *layer, msg);
+      deleteLayer(header, *layer, groups[getLayerGroup(layer_id)]);
+      layers_changed |= layer_cache_.erase(layer_id) > 0;
     } else {
-      drawLayer(header, *layer, *layer_config, msg);
+      layer_draws.push_back({layer.get(),
+                             layer_config,
+                             &layer_cache_[layer_id],
+                             &groups[getLayerGroup(layer_id)]});
     }
   }
 
-  if (visualizer_config.draw_mesh_edges) {
-    drawLayerMeshEdges(header, mesh_edge_source_layer_, mesh_edge_ns_, msg);
+  // layers and plugins are independent of each other
+  std::vector<TaskPool::Task> tasks;
+  for (auto& draw : layer_draws) {
+    tasks.push_back([this, &header, &draw]() {
+      draw.changed =
+          drawLayerIfChanged(header, *draw.layer, *draw.config, *draw.cache, *draw.msg);
+    });
   }
 
-  std::map<LayerId, LayerConfig> all_configs;
-  for (const auto layer_id : scene_graph_->layer_ids) {
-    all_configs[layer_id] = *CHECK_NOTNULL(config_manager_->getLayerConfig(layer_id));
+  for (const auto& plugin : plugins_) {
+    tasks.push_back([this, &header, plugin]() {
+      plugin->draw(*config_manager_, header, *scene_graph_);
+    });
+  }
+
+  draw_pool_->run(tasks);
+  for (const auto& draw : layer_draws) {
+    layers_changed |= draw.changed;
+  }
+
+  // edges between layers depend on whether any layer changed
+  MarkerArray& mesh_edge_msg = groups["mesh_edges"];
+  MarkerArray& interlayer_edge_msg = groups["interlayer_edges"];
+  MarkerArray& dynamic_edge_msg = groups["dynamic_interlayer_edges"];
+  MarkerArray dynamic_markers;
+  tasks.clear();
+  // mesh vertices can move without the connected layer changing
+  const auto mesh_edges_hash =
+      visualizer_config.draw_mesh_edges ? hashMeshEdges(mesh_edge_source_layer_) : 0;
+  const bool mesh_changed = mesh_edges_hash != mesh_edges_hash_;
+  mesh_edges_hash_ = mesh_edges_hash;
+  if (visualizer_config.draw_mesh_edges &&
+      (layers_changed || mesh_changed || redraw_all_)) {
+    tasks.push_back([&]() {
+      drawLayerMeshEdges(header, mesh_edge_source_layer_, mesh_edge_ns_, mesh_edge_msg);
+    });
+  }
+
+  tasks.push_back([&]() {
+    drawInterlayerEdges(header, all_configs, layers_changed, interlayer_edge_msg);
+  });
+  tasks.push_back([&]() { drawDynamicLayers(header, dynamic_markers); });
+  tasks.push_back([&]() {
+    drawDynamicInterlayerEdges(
+        header, all_configs, all_dynamic_configs, dynamic_edge_msg);
+  });
+  draw_pool_->run(tasks);
+
+  if (!dynamic_markers.markers.empty()) {
+    dynamic_layers_viz_pub_.publish(dynamic_markers);
+  }
+}
+
+void DynamicSceneGraphVisualizer::drawInterlayerEdges(
+    const std_msgs::Header& header,
+    const std::map<LayerId, LayerConfig>& all_configs,
+    bool layers_changed,
+    MarkerArray& msg) {
+  const auto& visualizer_config = config_manager_->getVisualizerConfig();
+
+  // interlayer edges only need to be redrawn if they or their endpoints changed
+  size_t interlayer_hash = scene_graph_->interlayer_edges().size();
+  for (const auto& id_edge_pair : scene_graph_->interlayer_edges()) {
+    size_t seed = std::hash<NodeId>()(id_edge_pair.second.source);
+    hashCombine(seed, id_edge_pair.second.target);
+    interlayer_hash += seed;
+  }
+
+  if (!layers_changed && !redraw_all_ && interlayer_edge_cache_ &&
+      interlayer_edge_cache_->hash == interlayer_hash) {
+    return;
   }
 
-  MarkerArray interlayer_edge_markers =
-      makeGraphEdgeMarkers(header,
-                           *scene_graph_,
-                           all_configs,
-                           visualizer_config,
-                           interlayer_edge_ns_prefix_);
+  fillGraphEdgeMarkers(header,
+                       *scene_graph_,
+                       all_configs,
+                       visualizer_config,
+                       interlayer_edge_ns_prefix_,
+                       interlayer_edge_buffer_);
 
-  std::set<std::string> seen_edge_labels;
-  for (const auto& marker : interlayer_edge_markers.markers) {
-    addMultiMarkerIfValid(marker, msg);
-    seen_edge_labels.insert(marker.ns);
+  for (auto& entry : interlayer_edge_buffer_.entries) {
+    if (entry.active) {
+      addMultiMarkerIfValid(takeMarker(entry.marker), msg);
+    }
   }
 
   for (const auto& source_pair : all_configs) {
@@ -368,7 +570,7 @@ void DynamicSceneGraphVisualizer::redrawImpl(const std_msgs::Header& header,
       const std::string curr_ns = interlayer_edge_ns_prefix_ +
                                   std::to_string(source_pair.first) + "_" +
                                   std::to_string(target_pair.first);
-      if (seen_edge_labels.count(curr_ns)) {
+      if (interlayer_edge_buffer_.contains(curr_ns)) {
         continue;
       }
 
@@ -376,28 +578,27 @@ void DynamicSceneGraphVisualizer::redrawImpl(const std_msgs::Header& header,
     }
   }
 
-  MarkerArray dynamic_markers;
-  drawDynamicLayers(header, dynamic_markers);
-
-  std::map<LayerId, DynamicLayerConfig> all_dynamic_configs;
-  for (const auto& id_layer_pair : scene_graph_->dynamicLayers()) {
-    const auto layer_id = id_layer_pair.first;
-    all_dynamic_configs[layer_id] = config_manager_->getDynamicLayerConfig(layer_id);
-  }
+  interlayer_edge_cache_ = MarkerCache{true, interlayer_hash};
+}
 
+void DynamicSceneGraphVisualizer::drawDynamicInterlayerEdges(
+    const std_msgs::Header& header,
+    const std::map<LayerId, LayerConfig>& all_configs,
+    const std::map<LayerId, DynamicLayerConfig>& all_dynamic_configs,
+    MarkerArray& msg) {
   const std::string dynamic_interlayer_edge_prefix = "dynamic_interlayer_edges_";
-  MarkerArray dynamic_interlayer_edge_markers =
-      makeDynamicGraphEdgeMarkers(header,
-                                  *scene_graph_,
-                                  all_configs,
-                                  all_dynamic_configs,
-                                  visualizer_config,
-                                  dynamic_interlayer_edge_prefix);
-
-  std::set<std::string> seen_dyn_edge_labels;
-  for (const auto& marker : dynamic_interlayer_edge_markers.markers) {
-    addMultiMarkerIfValid(marker, msg);
-    seen_dyn_edge_labels.insert(marker.ns);
+  fillDynamicGraphEdgeMarkers(header,
+                              *scene_graph_,
+                              all_configs,
+                              all_dynamic_configs,
+                              config_manager_->getVisualizerConfig(),
+                              dynamic_interlayer_edge_prefix,
+                              dynamic_interlayer_edge_buffer_);
+
+  for (auto& entry : dynamic_interlayer_edge_buffer_.entries) {
+    if (entry.active) {
+      addMultiMarkerIfValid(takeMarker(entry.marker), msg);
+    }
   }
 
   for (const auto& source_pair : all_configs) {
@@ -405,31 +606,24 @@ void DynamicSceneGraphVisualizer::redrawImpl(const std_msgs::Header& header,
       std::string source_to_target_ns = dynamic_interlayer_edge_prefix +
                                         std::to_string(source_pair.first) + "_" +
                                         std::to_string(target_pair.first);
-      if (!seen_dyn_edge_labels.count(source_to_target_ns)) {
+      if (!dynamic_interlayer_edge_buffer_.contains(source_to_target_ns)) {
         deleteMultiMarker(header, source_to_target_ns, msg);
       }
 
       std::string target_to_source_ns = dynamic_interlayer_edge_prefix +
                                         std::to_string(target_pair.first) + "_" +
                                         std::to_string(source_pair.first);
-      if (!seen_dyn_edge_labels.count(target_to_source_ns)) {
+      if (!dynamic_interlayer_edge_buffer_.contains(target_to_source_ns)) {
         deleteMultiMarker(header, target_to_source_ns, msg);
       }
     }
   }
-
-  if (!dynamic_markers.markers.empty()) {
-    dynamic_layers_viz_pub_.publish(dynamic_markers);
-  }
-
-  for (const auto& plugin : plugins_) {
-    plugin->draw(*config_manager_, header, *scene_graph_);
-  }
 }
 
 void DynamicSceneGraphVisualizer::deleteMultiMarker(const std_msgs::Header& header,
                                                     const std::string& ns,
                                                     MarkerArray& msg) {
+  std::lock_guard<std::mutex> lock(published_mutex_);
   if (!published_multimarkers_.count(ns)) {
     return;
   }
@@ -440,15 +634,42 @@ void DynamicSceneGraphVisualizer::deleteMultiMarker(const std_msgs::Header& head
   published_multimarkers_.erase(ns);
 }
 
-void DynamicSceneGraphVisualizer::addMultiMarkerIfValid(const Marker& marker,
+void DynamicSceneGraphVisualizer::addMultiMarkerIfValid(Marker&& marker,
                                                         MarkerArray& msg) {
-  if (!marker.points.empty()) {
-    msg.markers.push_back(marker);
-    published_multimarkers_.insert(marker.ns);
+  if (marker.points.empty()) {
+    deleteMultiMarker(marker.header, marker.ns, msg);
     return;
   }
 
-  deleteMultiMarker(marker.header, marker.ns, msg);
+  {  // the namespace has to be recorded before the marker is moved
+    std::lock_guard<std::mutex> lock(published_mutex_);
+    published_multimarkers_.insert(marker.ns);
+  }
+
+  msg.markers.push_back(std::move(marker));
+}
+
+bool DynamicSceneGraphVisualizer::drawLayerIfChanged(const std_msgs::Header& header,
+                                                     const SceneGraphLayer& layer,
+                                                     const LayerConfig& config,
+                                                     MarkerCache& cache,
+                                                     MarkerArray& msg) {
+  const auto hash = hashLayer(layer, config);
+  if (!config_changed_ && !redraw_all_ && cache.valid && cache.hash == hash) {
+    return false;
+  }
+
+  // every layer has its own group, so the layer can be drawn straight into it
+  drawLayer(header, layer, config, msg);
+  cache.valid = true;
+  cache.hash = hash;
+  return true;
+}
+
+void DynamicSceneGraphVisualizer::handleNewSubscriber(
+    const ros::SingleSubscriberPublisher&) {
+  redraw_all_ = true;
+  need_redraw_ = true;
 }
 
 void DynamicSceneGraphVisualizer::displayLoop(const ros::WallTimerEvent&) {
@@ -508,6 +729,66 @@ Color getFrontierColor(const SceneGraphNode& node) {
   }
 }
 
+size_t DynamicSceneGraphVisualizer::hashLayer(const SceneGraphLayer& layer,
+                                              const LayerConfig& config) const {
+  // the node attributes that colors are computed from are part of the contents and
+  // config or colormap changes already redraw every layer
+  size_t hash = hashLayerContents(layer);
+  if (layer_colors_.count(layer.id)) {
+    return hash;  // replacing a color function drops the cached hash
+  }
+
+  const auto curr_mode = static_cast<NodeColorMode>(config.marker_color_mode);
+  hashCombine(hash, config.marker_color_mode);
+  if (curr_mode != NodeColorMode::PARENT) {
+    return hash;
+  }
+
+  // parent colors are the only color input from outside the layer
+  size_t parents_hash = 0;
+  for (const auto& id_node_pair : layer.nodes()) {
+    const auto parent = id_node_pair.second->getParent();
+    if (!parent || !scene_graph_->hasNode(*parent)) {
+      continue;
+    }
+
+    const auto& attrs = scene_graph_->getNode(*parent).attributes();
+    const auto semantic = dynamic_cast<const SemanticNodeAttributes*>(&attrs);
+    if (semantic) {
+      size_t seed = std::hash<NodeId>()(*parent);
+      hashCombine(seed, hashColor(semantic->color));
+      parents_hash += seed;
+    }
+  }
+
+  hashCombine(hash, parents_hash);
+  return hash;
+}
+
+size_t DynamicSceneGraphVisualizer::hashMeshEdges(LayerId layer_id) const {
+  const auto mesh = scene_graph_->mesh();
+  if (!mesh || !scene_graph_->hasLayer(layer_id)) {
+    return 0;
+  }
+
+  size_t hash = mesh->numVertices();
+  for (const auto& id_node_pair : scene_graph_->getLayer(layer_id).nodes()) {
+    const auto& attrs = id_node_pair.second->attributes<Place2dNodeAttributes>();
+    for (const auto midx : attrs.pcl_mesh_connections) {
+      if (midx >= mesh->numVertices()) {
+        continue;
+      }
+
+      const auto pos = mesh->pos(midx);
+      for (int i = 0; i < pos.size(); ++i) {
+        hashCombine(hash, std::hash<float>()(pos(i)));
+      }
+    }
+  }
+
+  return hash;
+}
+
 Color DynamicSceneGraphVisualizer::getParentColor(
     const SceneGraphNode& node) const {
   auto parent = node.getParent();
@@ -518,6 +799,49 @@ Color DynamicSceneGraphVisualizer::getParentColor(
   return scene_graph_->getNode(*parent).attributes<SemanticNodeAttributes>().color;
 }
 
+ColorFunction DynamicSceneGraphVisualizer::getLayerColorFunction(
+    const SceneGraphLayer& layer, const LayerConfig& config) const {
+  auto iter = layer_colors_.find(layer.id);
+  if (iter != layer_colors_.end()) {
+    return iter->second;
+  }
+
+  const auto curr_mode = static_cast<NodeColorMode>(config.marker_color_mode);
+  switch (curr_mode) {
+    case NodeColorMode::ACTIVE:
+      return getActiveColor;
+    case NodeColorMode::ACTIVE_MESH:
+      return getActiveMeshColor;
+    case NodeColorMode::NEED_CLEANUP:
+      return getCleanupColor;
+    case NodeColorMode::FRONTIER:
+      return getFrontierColor;
+    case NodeColorMode::DISTANCE: {
+      const auto* viz_config = &config_manager_->getVisualizerConfig();
+      const auto* colormap = &config_manager_->getColormapConfig("places_colormap");
+      return [viz_config, colormap](const SceneGraphNode& node) -> Color {
+        try {
+          return getDistanceColor(
+              *viz_config, *colormap, node.attributes<PlaceNodeAttributes>().distance);
+        } catch (const std::bad_cast&) {
+          return Color();
+        }
+      };
+    }
+    case NodeColorMode::PARENT:
+      return [this](const auto& node) { return getParentColor(node); };
+    case NodeColorMode::DEFAULT:
+    default:
+      return [](const SceneGraphNode& node) -> Color {
+        try {
+          return node.attributes<SemanticNodeAttributes>().color;
+        } catch (const std::bad_cast&) {
+          return Color();
+        }
+      };
+  }
+}
+
 void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
                                             const SceneGraphLayer& layer,
                                             const LayerConfig& config,
@@ -525,67 +849,20 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
   const auto& viz_config = config_manager_->getVisualizerConfig();
   const std::string node_ns = getLayerNodeNamespace(layer.id);
 
-  ColorFunction layer_color_func;
-  auto iter = layer_colors_.find(layer.id);
-  if (iter != layer_colors_.end()) {
-    layer_color_func = iter->second;
-  } else {
-    const auto curr_mode = static_cast<NodeColorMode>(config.marker_color_mode);
-    switch (curr_mode) {
-      case NodeColorMode::ACTIVE:
-        layer_color_func = getActiveColor;
-        break;
-      case NodeColorMode::ACTIVE_MESH:
-        layer_color_func = getActiveMeshColor;
-        break;
-      case NodeColorMode::NEED_CLEANUP:
-        layer_color_func = getCleanupColor;
-        break;
-      case NodeColorMode::FRONTIER:
-        layer_color_func = getFrontierColor;
-        break;
-      case NodeColorMode::DISTANCE:
-        layer_color_func = [&](const SceneGraphNode& node) -> Color {
-          try {
-            return getDistanceColor(
-                viz_config,
-                config_manager_->getColormapConfig("places_colormap"),
-                node.attributes<PlaceNodeAttributes>().distance);
-          } catch (const std::bad_cast&) {
-            return Color();
-          }
-        };
-        break;
-      case NodeColorMode::PARENT:
-        layer_color_func = [this](const auto& node) { return getParentColor(node); };
-        break;
-      case NodeColorMode::DEFAULT:
-      default:
-        layer_color_func = [](const SceneGraphNode& node) -> Color {
-          try {
-            return node.attributes<SemanticNodeAttributes>().color;
-          } catch (const std::bad_cast&) {
-            return Color();
-          }
-        };
-        break;
-    }
-  }
+  const auto layer_color_func = getLayerColorFunction(layer, config);
 
   if (config.draw_frontier_ellipse) {
     std::vector<Marker> ellipsoids = makeEllipsoidMarkers(
         header, config, layer, viz_config, "frontier_ns", layer_color_func);
-    for (auto e : ellipsoids) {
-      msg.markers.push_back(e);
-    }
+    std::move(ellipsoids.begin(), ellipsoids.end(), std::back_inserter(msg.markers));
 
     auto nodes = makePlaceCentroidMarkers(
         header, config, layer, viz_config, node_ns, layer_color_func);
-    addMultiMarkerIfValid(nodes, msg);
+    addMultiMarkerIfValid(std::move(nodes), msg);
   } else {
     auto nodes = makeCentroidMarkers(
         header, config, layer, viz_config, node_ns, layer_color_func);
-    addMultiMarkerIfValid(nodes, msg);
+    addMultiMarkerIfValid(std::move(nodes), msg);
   }
 
   const std::string edge_ns = getLayerEdgeNamespace(layer.id);
@@ -601,7 +878,7 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
     edges = makeLayerEdgeMarkers(
         header, config, layer, viz_config, Color(), edge_ns);
   }
-  addMultiMarkerIfValid(edges, msg);
+  addMultiMarkerIfValid(std::move(edges), msg);
 
   const std::string label_ns = getLayerLabelNamespace(layer.id);
 
@@ -611,7 +888,7 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
 
     if (config.use_label) {
       Marker label = makeTextMarker(header, config, node, viz_config, label_ns);
-      msg.markers.push_back(label);
+      msg.markers.push_back(std::move(label));
       curr_labels_.at(layer.id).insert(node.id);
     }
   }
@@ -621,7 +898,7 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
       const Node& node = *id_node_pair.second;
 
       Marker label = makeTextMarkerNoHeight(header, config, node, viz_config, label_ns);
-      msg.markers.push_back(label);
+      msg.markers.push_back(std::move(label));
       curr_labels_.at(layer.id).insert(node.id);
     }
   }
@@ -632,12 +909,12 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
     try {
       Marker bbox = makeLayerWireframeBoundingBoxes(
           header, config, layer, viz_config, bbox_ns, layer_color_func);
-      addMultiMarkerIfValid(bbox, msg);
+      addMultiMarkerIfValid(std::move(bbox), msg);
 
       if (config.collapse_bounding_box) {
         Marker bbox_edges = makeEdgesToBoundingBoxes(
             header, config, layer, viz_config, bbox_edge_ns, layer_color_func);
-        addMultiMarkerIfValid(bbox_edges, msg);
+        addMultiMarkerIfValid(std::move(bbox_edges), msg);
       } else {
         deleteMultiMarker(header, bbox_edge_ns, msg);
       }
@@ -655,12 +932,12 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
     try {
       Marker boundary =
           makeLayerPolygonBoundaries(header, config, layer, viz_config, boundary_ns);
-      addMultiMarkerIfValid(boundary, msg);
+      addMultiMarkerIfValid(std::move(boundary), msg);
 
       if (config.collapse_boundary) {
         Marker boundary_edges =
             makeLayerPolygonEdges(header, config, layer, viz_config, boundary_edge_ns);
-        addMultiMarkerIfValid(boundary_edges, msg);
+        addMultiMarkerIfValid(std::move(boundary_edges), msg);
       } else {
         deleteMultiMarker(header, boundary_edge_ns, msg);
       }
@@ -677,7 +954,7 @@ void DynamicSceneGraphVisualizer::drawLayer(const std_msgs::Header& header,
     try {
       Marker boundary_ellipse = makeLayerEllipseBoundaries(
           header, config, layer, viz_config, boundary_ellipse_ns);
-      addMultiMarkerIfValid(boundary_ellipse, msg);
+      addMultiMarkerIfValid(std::move(boundary_ellipse), msg);
     } catch (const std::bad_cast&) {
       // TODO(nathan) consider warning
     }
@@ -713,7 +990,7 @@ void DynamicSceneGraphVisualizer::drawLayerMeshEdges(const std_msgs::Header& hea
                                           *scene_graph_,
                                           scene_graph_->getLayer(layer_id),
                                           ns);
-  addMultiMarkerIfValid(mesh_edges, msg);
+  addMultiMarkerIfValid(std::move(mesh_edges), msg);
 }
 
 }  // namespace hydra
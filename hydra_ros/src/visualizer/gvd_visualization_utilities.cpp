@@ -36,7 +36,12 @@
 
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
 #include <random>
+#include <sstream>
 
 #include "hydra_ros/visualizer/colormap_utilities.h"
 
@@ -50,31 +55,203 @@ using visualization_msgs::MarkerArray;
 
 using dsg_utils::computeRatio;
 
+struct MarkerGroupPub::BuildStats {
+  std::atomic<size_t> num_built{0};
+  std::atomic<size_t> num_unsubscribed{0};
+  std::atomic<size_t> num_rate_limited{0};
+};
+
+namespace {
+
+// shared by every MarkerGroupPub so that skipped work can be reported in one place
+// (only touched when a topic is advertised, the counters themselves are atomic)
+std::mutex stats_mutex;
+std::map<std::string, std::shared_ptr<MarkerGroupPub::BuildStats>> build_stats;
+
+// rviz applies markers in order, so later markers replace earlier markers with the
+// same namespace and id and a DELETEALL replaces everything before it
+void mergeMarkers(MarkerArray& pending, MarkerArray& msg) {
+  std::map<std::pair<std::string, int32_t>, size_t> indices;
+  for (size_t i = 0; i < pending.markers.size(); ++i) {
+    indices[{pending.markers[i].ns, pending.markers[i].id}] = i;
+  }
+
+  for (auto& marker : msg.markers) {
+    if (marker.action == Marker::DELETEALL) {
+      pending.markers.clear();
+      indices.clear();
+    }
+
+    const auto iter = indices.find({marker.ns, marker.id});
+    if (iter != indices.end()) {
+      pending.markers[iter->second] = std::move(marker);
+      continue;
+    }
+
+    indices[{marker.ns, marker.id}] = pending.markers.size();
+    pending.markers.push_back(std::move(marker));
+  }
+}
+
+}  // namespace
+
 MarkerGroupPub::MarkerGroupPub(const ros::NodeHandle& nh) : nh_(nh) {}
 
-void MarkerGroupPub::publish(const std::string& name,
-                             const MarkerCallback& func) const {
-  publish(name, [&func](MarkerArray& msg) {
-    Marker marker;
-    msg.markers.push_back(marker);
-    return func(msg.markers.back());
-  });
+std::string MarkerGroupPub::skippedWorkReport() {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  std::stringstream ss;
+  ss << "marker builds (built / skipped without subscribers / deferred by rate):";
+  for (const auto& [topic, stats] : build_stats) {
+    ss << std::endl
+       << "  " << topic << ": " << stats->num_built << " / "
+       << stats->num_unsubscribed << " / " << stats->num_rate_limited;
+  }
+
+  return ss.str();
 }
 
-void MarkerGroupPub::publish(const std::string& name, const ArrayCallback& func) const {
+MarkerGroupPub::Topic& MarkerGroupPub::advertise(const std::string& name) const {
   auto iter = pubs_.find(name);
-  if (iter == pubs_.end()) {
-    iter = pubs_.emplace(name, nh_.advertise<MarkerArray>(name, 1, true)).first;
+  if (iter != pubs_.end()) {
+    return iter->second;
+  }
+
+  // map entries never move, so the callback can hold on to the topic
+  auto& topic = pubs_[name];
+  topic.resolved_name = nh_.resolveName(name);
+  nh_.param(name + "/min_period", topic.min_period_s, 0.0);
+  {  // topics with the same name share their counters
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    auto& stats = build_stats[topic.resolved_name];
+    if (!stats) {
+      stats = std::make_shared<BuildStats>();
+    }
+
+    topic.stats = stats;
+  }
+
+  topic.trailing_timer = nh_.createWallTimer(
+      ros::WallDuration(1.0),
+      [&topic](const ros::WallTimerEvent&) { sendPending(topic); },
+      true,
+      false);
+  topic.pub = nh_.advertise<MarkerArray>(
+      name,
+      1,
+      [&topic](const ros::SingleSubscriberPublisher&) { topic.new_subscribers = true; },
+      ros::SubscriberStatusCallback(),
+      ros::VoidConstPtr(),
+      true);
+  return topic;
+}
+
+MarkerGroupPub::Topic* MarkerGroupPub::getTopic(const std::string& name) const {
+  auto& topic = advertise(name);
+  if (!topic.pub.getNumSubscribers()) {
+    // avoid doing computation if we don't need to publish
+    ++topic.stats->num_unsubscribed;
+    return nullptr;
+  }
+
+  return &topic;
+}
+
+void MarkerGroupPub::send(Topic& topic, bool merge) const {
+  ++topic.stats->num_built;
+  double delay_s = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(topic.mutex);
+    const auto now = ros::WallTime::now();
+    const double elapsed_s = (now - topic.last_publish).toSec();
+    if (topic.min_period_s <= 0.0 || topic.last_publish.isZero() ||
+        elapsed_s >= topic.min_period_s) {
+      if (topic.has_pending && merge) {
+        // markers that were held back still have to reach the subscribers
+        mergeMarkers(topic.pending, topic.msg);
+        topic.pending.markers.swap(topic.msg.markers);
+      }
+
+      topic.has_pending = false;
+      topic.last_publish = now;
+      topic.pub.publish(topic.msg);
+      return;
+    }
+
+    ++topic.stats->num_rate_limited;
+    if (topic.has_pending && merge) {
+      mergeMarkers(topic.pending, topic.msg);
+    } else {
+      topic.pending.markers.swap(topic.msg.markers);
+    }
+
+    if (topic.has_pending) {
+      return;  // the timer is already running
+    }
+
+    topic.has_pending = true;
+    delay_s = topic.min_period_s - elapsed_s;
+  }
+
+  // restarted outside of the lock as stopping a timer waits for its callback
+  topic.trailing_timer.stop();
+  topic.trailing_timer.setPeriod(ros::WallDuration(delay_s));
+  topic.trailing_timer.start();
+}
+
+void MarkerGroupPub::sendPending(Topic& topic) {
+  std::lock_guard<std::mutex> lock(topic.mutex);
+  if (!topic.has_pending) {
+    return;  // already sent with a newer message
   }
 
-  if (!iter->second.getNumSubscribers()) {
-    return;  // avoid doing computation if we don't need to publish
+  topic.has_pending = false;
+  topic.last_publish = ros::WallTime::now();
+  topic.pub.publish(topic.pending);
+}
+
+void MarkerGroupPub::setMinPeriod(const std::string& name, double min_period_s) const {
+  advertise(name).min_period_s = min_period_s;
+}
+
+bool MarkerGroupPub::hasSubscribers(const std::string& name) const {
+  return advertise(name).pub.getNumSubscribers() > 0;
+}
+
+bool MarkerGroupPub::checkNewSubscribers(const std::string& name) const {
+  return advertise(name).new_subscribers.exchange(false);
+}
+
+bool MarkerGroupPub::publish(const std::string& name,
+                             const MarkerCallback& func) const {
+  auto topic = getTopic(name);
+  if (!topic) {
+    return false;
+  }
+
+  // reset the marker from the last call
+  auto& msg = topic->msg;
+  msg.markers.resize(1);
+  msg.markers.front() = Marker();
+  if (func(msg.markers.front())) {
+    send(*topic, false);
+  }
+
+  return true;
+}
+
+bool MarkerGroupPub::publish(const std::string& name, const ArrayCallback& func) const {
+  auto topic = getTopic(name);
+  if (!topic) {
+    return false;
   }
 
-  MarkerArray msg;
+  auto& msg = topic->msg;
+  msg.markers.clear();
   if (func(msg)) {
-    iter->second.publish(msg);
+    send(*topic, true);
   }
+
+  return true;
 }
 
 double getRatioFromDistance(const GvdVisualizerConfig& config, const GvdVoxel& voxel) {
@@ -100,14 +277,13 @@ double getRatio(const GvdVisualizerConfig& config, const GvdVoxel& voxel) {
   return 0.0;
 }
 
-Marker makeGvdMarker(const GvdVisualizerConfig& config,
-                     const ColormapConfig& colors,
-                     const GvdLayer& layer) {
-  Marker marker;
+namespace {
+
+void resetVoxelMarker(const GvdLayer& layer, const std::string& ns, Marker& marker) {
   marker.type = Marker::CUBE_LIST;
   marker.action = Marker::ADD;
   marker.id = 0;
-  marker.ns = "gvd_markers";
+  marker.ns = ns;
 
   Eigen::Vector3d identity_pos = Eigen::Vector3d::Zero();
   tf2::convert(identity_pos, marker.pose.position);
@@ -116,27 +292,80 @@ Marker makeGvdMarker(const GvdVisualizerConfig& config,
   marker.scale.x = layer.voxel_size;
   marker.scale.y = layer.voxel_size;
   marker.scale.z = layer.voxel_size;
+  marker.points.clear();
+  marker.colors.clear();
+}
 
-  for (const auto& block : layer) {
-    for (size_t i = 0; i < block.numVoxels(); ++i) {
-      const auto& voxel = block.getVoxel(i);
-      if (!voxel.observed || voxel.num_extra_basis < config.basis_threshold) {
-        continue;
-      }
+template <typename BlockT>
+void addGvdVoxels(const GvdVisualizerConfig& config,
+                  const ColormapConfig& colors,
+                  const BlockT& block,
+                  std::vector<geometry_msgs::Point>& points,
+                  std::vector<std_msgs::ColorRGBA>& point_colors) {
+  for (size_t i = 0; i < block.numVoxels(); ++i) {
+    const auto& voxel = block.getVoxel(i);
+    if (!voxel.observed || voxel.num_extra_basis < config.basis_threshold) {
+      continue;
+    }
 
-      const Eigen::Vector3d voxel_pos = block.getVoxelPosition(i).cast<double>();
-      geometry_msgs::Point marker_pos;
-      tf2::convert(voxel_pos, marker_pos);
-      marker.points.push_back(marker_pos);
+    const Eigen::Vector3d voxel_pos = block.getVoxelPosition(i).cast<double>();
+    auto& marker_pos = points.emplace_back();
+    tf2::convert(voxel_pos, marker_pos);
 
-      double ratio = getRatio(config, voxel);
-      Color color = dsg_utils::interpolateColorMap(colors, ratio);
+    double ratio = getRatio(config, voxel);
+    Color color = dsg_utils::interpolateColorMap(colors, ratio);
+    point_colors.push_back(dsg_utils::makeColorMsg(color, config.gvd_alpha));
+  }
+}
 
-      std_msgs::ColorRGBA color_msg = dsg_utils::makeColorMsg(color, config.gvd_alpha);
-      marker.colors.push_back(color_msg);
+}  // namespace
+
+void fillGvdMarker(const GvdVisualizerConfig& config,
+                   const ColormapConfig& colors,
+                   const GvdLayer& layer,
+                   Marker& marker) {
+  resetVoxelMarker(layer, "gvd_markers", marker);
+  for (const auto& block : layer) {
+    addGvdVoxels(config, colors, block, marker.points, marker.colors);
+  }
+}
+
+void GvdMarkerCache::fill(const GvdVisualizerConfig& config,
+                          const ColormapConfig& colors,
+                          const GvdLayer& layer,
+                          Marker& marker) {
+  // unchanged blocks are moved over, which also drops blocks that were removed
+  size_t num_points = 0;
+  decltype(blocks_) blocks;
+  for (const auto& block : layer) {
+    auto& entry = blocks[block.index];
+    auto iter = valid_ ? blocks_.find(block.index) : blocks_.end();
+    if (iter != blocks_.end() && !block.updated) {
+      entry = std::move(iter->second);
+    } else {
+      addGvdVoxels(config, colors, block, entry.points, entry.colors);
     }
+
+    num_points += entry.points.size();
+  }
+
+  blocks_.swap(blocks);
+  valid_ = true;
+
+  resetVoxelMarker(layer, "gvd_markers", marker);
+  marker.points.reserve(num_points);
+  marker.colors.reserve(num_points);
+  for (const auto& [index, entry] : blocks_) {
+    marker.points.insert(marker.points.end(), entry.points.begin(), entry.points.end());
+    marker.colors.insert(marker.colors.end(), entry.colors.begin(), entry.colors.end());
   }
+}
 
+Marker makeGvdMarker(const GvdVisualizerConfig& config,
+                     const ColormapConfig& colors,
+                     const GvdLayer& layer) {
+  Marker marker;
+  fillGvdMarker(config, colors, layer, marker);
   return marker;
 }
 
@@ -231,22 +460,11 @@ Marker makeSurfaceVoxelMarker(const GvdVisualizerConfig& config,
   return marker;
 }
 
-Marker makeEsdfMarker(const GvdVisualizerConfig& config,
-                      const ColormapConfig& colors,
-                      const GvdLayer& layer) {
-  Marker marker;
-  marker.type = Marker::CUBE_LIST;
-  marker.action = Marker::ADD;
-  marker.id = 0;
-  marker.ns = "esdf_slice_markers";
-
-  Eigen::Vector3d identity_pos = Eigen::Vector3d::Zero();
-  tf2::convert(identity_pos, marker.pose.position);
-  tf2::convert(Eigen::Quaterniond::Identity(), marker.pose.orientation);
-
-  marker.scale.x = layer.voxel_size;
-  marker.scale.y = layer.voxel_size;
-  marker.scale.z = layer.voxel_size;
+void fillEsdfMarker(const GvdVisualizerConfig& config,
+                    const ColormapConfig& colors,
+                    const GvdLayer& layer,
+                    Marker& marker) {
+  resetVoxelMarker(layer, "esdf_slice_markers", marker);
 
   const float voxel_size = layer.voxel_size;
   const float half_voxel_size = voxel_size / 2.0;
@@ -254,7 +472,26 @@ Marker makeEsdfMarker(const GvdVisualizerConfig& config,
   const float slice_height =
       std::floor(config.slice_height / voxel_size) * voxel_size + half_voxel_size;
 
+  size_t num_slice_blocks = 0;
   for (const auto& block : layer) {
+    const float block_min_z = block.origin().z();
+    if (slice_height >= block_min_z && slice_height < block_min_z + block.block_size) {
+      ++num_slice_blocks;
+    }
+  }
+
+  const size_t voxels_per_side = layer.voxels_per_side;
+  marker.points.reserve(num_slice_blocks * voxels_per_side * voxels_per_side);
+  marker.colors.reserve(num_slice_blocks * voxels_per_side * voxels_per_side);
+
+  for (const auto& block : layer) {
+    // only blocks that contain the slice can have voxels in it
+    const float block_min_z = block.origin().z();
+    if (slice_height < block_min_z - half_voxel_size ||
+        slice_height > block_min_z + block.block_size + half_voxel_size) {
+      continue;
+    }
+
     for (size_t i = 0; i < block.numVoxels(); ++i) {
       const auto& voxel = block.getVoxel(i);
       if (!voxel.observed) {
@@ -267,22 +504,103 @@ Marker makeEsdfMarker(const GvdVisualizerConfig& config,
         continue;
       }
 
-      geometry_msgs::Point marker_pos;
+      auto& marker_pos = marker.points.emplace_back();
       tf2::convert(voxel_pos, marker_pos);
-      marker.points.push_back(marker_pos);
 
       double ratio = computeRatio(
           config.esdf_min_distance, config.esdf_max_distance, voxel.distance);
       Color color = dsg_utils::interpolateColorMap(colors, ratio);
-
-      std_msgs::ColorRGBA color_msg = dsg_utils::makeColorMsg(color, config.esdf_alpha);
-      marker.colors.push_back(color_msg);
+      marker.colors.push_back(dsg_utils::makeColorMsg(color, config.esdf_alpha));
     }
   }
+}
 
+Marker makeEsdfMarker(const GvdVisualizerConfig& config,
+                      const ColormapConfig& colors,
+                      const GvdLayer& layer) {
+  Marker marker;
+  fillEsdfMarker(config, colors, layer, marker);
   return marker;
 }
 
+void resetSliceGrid(float voxel_size,
+                    double height,
+                    const Eigen::AlignedBox2f& extent,
+                    nav_msgs::OccupancyGrid& msg) {
+  msg.info.resolution = voxel_size;
+  msg.info.origin.position.z = height;
+  msg.info.origin.orientation.w = 1.0;
+  if (extent.isEmpty()) {
+    msg.info.width = 0;
+    msg.info.height = 0;
+    msg.data.clear();
+    return;
+  }
+
+  const Eigen::Vector2f sizes = extent.sizes() / voxel_size;
+  msg.info.width = static_cast<uint32_t>(std::round(sizes.x()));
+  msg.info.height = static_cast<uint32_t>(std::round(sizes.y()));
+  msg.info.origin.position.x = extent.min().x();
+  msg.info.origin.position.y = extent.min().y();
+  msg.data.assign(msg.info.width * msg.info.height, -1);
+}
+
+void setSliceGridCell(const Eigen::Vector2f& pos,
+                      double ratio,
+                      nav_msgs::OccupancyGrid& msg) {
+  const float resolution = msg.info.resolution;
+  const int x = std::floor((pos.x() - msg.info.origin.position.x) / resolution);
+  const int y = std::floor((pos.y() - msg.info.origin.position.y) / resolution);
+  if (x < 0 || y < 0 || x >= static_cast<int>(msg.info.width) ||
+      y >= static_cast<int>(msg.info.height)) {
+    return;
+  }
+
+  const auto value = std::round(100.0 * std::clamp(ratio, 0.0, 1.0));
+  msg.data[y * msg.info.width + x] = static_cast<int8_t>(value);
+}
+
+void fillEsdfGrid(const GvdVisualizerConfig& config,
+                  const GvdLayer& layer,
+                  nav_msgs::OccupancyGrid& msg) {
+  const float voxel_size = layer.voxel_size;
+  // same voxel row as the marker slice
+  const float slice_height =
+      std::floor(config.slice_height / voxel_size) * voxel_size + voxel_size / 2.0;
+
+  Eigen::AlignedBox2f extent;
+  for (const auto& block : layer) {
+    const Eigen::Vector3f origin = block.origin();
+    if (slice_height >= origin.z() && slice_height < origin.z() + block.block_size) {
+      extent.extend(origin.head<2>());
+      extent.extend((origin.head<2>().array() + block.block_size).matrix());
+    }
+  }
+
+  resetSliceGrid(voxel_size, slice_height, extent, msg);
+  for (const auto& block : layer) {
+    const Eigen::Vector3f origin = block.origin();
+    if (slice_height < origin.z() || slice_height >= origin.z() + block.block_size) {
+      continue;
+    }
+
+    const size_t z = std::floor((slice_height - origin.z()) / voxel_size);
+    for (size_t x = 0; x < block.voxels_per_side; ++x) {
+      for (size_t y = 0; y < block.voxels_per_side; ++y) {
+        const VoxelIndex voxel_index(x, y, z);
+        const auto& voxel = block.getVoxel(voxel_index);
+        if (!voxel.observed) {
+          continue;
+        }
+
+        const double ratio = computeRatio(
+            config.esdf_min_distance, config.esdf_max_distance, voxel.distance);
+        setSliceGridCell(block.getVoxelPosition(voxel_index).head<2>(), ratio, msg);
+      }
+    }
+  }
+}
+
 inline Eigen::Vector3d getOffset(double side_length,
                                  bool x_high,
                                  bool y_high,
@@ -657,34 +975,44 @@ MarkerArray showGvdClusters(const GvdGraph& graph,
   return marker;
 }
 
+Marker makePlaceSphere(const std_msgs::Header& header,
+                       const SceneGraphNode& node,
+                       const std::string& ns,
+                       double alpha) {
+  const auto& attrs = node.attributes<PlaceNodeAttributes>();
+
+  Marker marker;
+  marker.header = header;
+  marker.type = Marker::SPHERE;
+  marker.action = visualization_msgs::Marker::ADD;
+  marker.id = node.id;
+  marker.ns = ns;
+
+  marker.scale.x = 2 * attrs.distance;
+  marker.scale.y = 2 * attrs.distance;
+  marker.scale.z = 2 * attrs.distance;
+  marker.pose.orientation.w = 1.0;
+  marker.pose.orientation.x = 0.0;
+  marker.pose.orientation.y = 0.0;
+  marker.pose.orientation.z = 0.0;
+  tf2::convert(attrs.position, marker.pose.position);
+
+  Color desired_color(255, 0, 0);
+  marker.color = dsg_utils::makeColorMsg(desired_color, alpha);
+  return marker;
+}
+
 MarkerArray makePlaceSpheres(const std_msgs::Header& header,
                              const SceneGraphLayer& layer,
                              const std::string& ns,
                              double alpha) {
   MarkerArray spheres;
+  spheres.markers.reserve(layer.numNodes());
   size_t id = 0;
   for (const auto& id_node_pair : layer.nodes()) {
-    const auto& attrs = id_node_pair.second->attributes<PlaceNodeAttributes>();
-
-    Marker marker;
-    marker.header = header;
-    marker.type = Marker::SPHERE;
-    marker.action = visualization_msgs::Marker::ADD;
+    auto& marker = spheres.markers.emplace_back(
+        makePlaceSphere(header, *id_node_pair.second, ns, alpha));
     marker.id = id;
-    marker.ns = ns;
-
-    marker.scale.x = 2 * attrs.distance;
-    marker.scale.y = 2 * attrs.distance;
-    marker.scale.z = 2 * attrs.distance;
-    marker.pose.orientation.w = 1.0;
-    marker.pose.orientation.x = 0.0;
-    marker.pose.orientation.y = 0.0;
-    marker.pose.orientation.z = 0.0;
-    tf2::convert(id_node_pair.second->attributes().position, marker.pose.position);
-
-    Color desired_color(255, 0, 0);
-    marker.color = dsg_utils::makeColorMsg(desired_color, alpha);
-    spheres.markers.push_back(marker);
     ++id;
   }
 
@@ -39,8 +39,15 @@
 #include <config_utilities/config_utilities.h>
 #include <config_utilities/parsing/ros.h>
 #include <config_utilities/printing.h>
+#include <fcntl.h>
 #include <glog/logging.h>
 #include <hydra/utils/timing_utilities.h>
+#include <spark_dsg/serialization/graph_binary_serialization.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hydra_ros/utils/dsg_log.h"
 
 namespace hydra {
 
@@ -54,6 +61,7 @@ void declare_config(HydraVisualizerConfig& config) {
   field(config.output_path, "output_path");
   field(config.zmq_url, "zmq_url");
   field(config.zmq_num_threads, "zmq_num_threads");
+  field(config.log_time, "log_time");
   field(config.plugins, "plugins");
 }
 
@@ -88,18 +96,108 @@ HydraVisualizer::~HydraVisualizer() {
             << std::endl;
 }
 
-void HydraVisualizer::loadGraph() {
-  ROS_INFO_STREAM("Loading dsg from: " << config_.scene_graph_filepath);
-  auto dsg = hydra::DynamicSceneGraph::load(config_.scene_graph_filepath);
+inline DynamicSceneGraph::Ptr loadGraphFromLog(const std::string& filepath,
+                                              double time_s) {
+  DsgLogReader reader(filepath);
+  if (!reader.valid() || reader.keyframes().empty()) {
+    ROS_ERROR_STREAM("No graphs in " << filepath);
+    return nullptr;
+  }
+
+  const auto start_ns = *reader.startTime();
+  const uint64_t offset_ns = time_s > 0.0 ? time_s * 1.0e9 : 0;
+  const uint64_t stamp_ns = time_s < 0.0 ? *reader.endTime() : start_ns + offset_ns;
+  const auto index = *reader.findKeyframe(stamp_ns);
+
+  // only the pages of the requested graph are read from the mapped log
+  DynamicSceneGraph::Ptr graph;
+  reader.viewKeyframe(index, [&](const uint8_t* buffer, size_t length) {
+    try {
+      graph = spark_dsg::io::binary::readGraph(buffer, length);
+    } catch (const std::exception& e) {
+      ROS_ERROR_STREAM("Failed to read graph from " << filepath << ": " << e.what());
+    }
+  });
+
+  const auto elapsed_s = (reader.keyframes()[index].stamp_ns - start_ns) * 1.0e-9;
+  ROS_INFO_STREAM("Loaded keyframe " << index << " @ " << elapsed_s << " [s] from log");
+  return graph;
+}
+
+inline DynamicSceneGraph::Ptr loadBinaryGraph(const std::string& filepath) {
+  // deserialize straight from a read-only mapping instead of copying the whole file
+  // into a buffer first
+  const int fd = open(filepath.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+
+    return DynamicSceneGraph::load(filepath);
+  }
+
+  void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return DynamicSceneGraph::load(filepath);
+  }
+
+  DynamicSceneGraph::Ptr graph;
+  try {
+    graph = spark_dsg::io::binary::readGraph(static_cast<const uint8_t*>(data),
+                                             info.st_size);
+  } catch (const std::exception& e) {
+    VLOG(1) << "Unable to read mapped graph from " << filepath << ": " << e.what();
+  }
+
+  munmap(data, info.st_size);
+  return graph ? graph : DynamicSceneGraph::load(filepath);
+}
+
+bool HydraVisualizer::loadGraph(bool force) {
+  const auto& filepath = config_.scene_graph_filepath;
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(filepath, ec);
+  const auto write_time = std::filesystem::last_write_time(filepath, ec);
+  if (ec) {
+    ROS_ERROR_STREAM("Unable to read " << filepath << ": " << ec.message());
+    return false;
+  }
+
+  const auto file_info = std::make_pair(size, write_time);
+  if (!force && loaded_file_ && *loaded_file_ == file_info) {
+    ROS_INFO_STREAM("Skipping reload of unchanged dsg: " << filepath);
+    return false;
+  }
+
+  ROS_INFO_STREAM("Loading dsg from: " << filepath);
+  DynamicSceneGraph::Ptr dsg;
+  const auto extension = std::filesystem::path(filepath).extension();
+  if (extension == ".log") {
+    dsg = loadGraphFromLog(filepath, config_.log_time);
+  } else if (extension == ".sparkdsg") {
+    dsg = loadBinaryGraph(filepath);
+  } else {
+    dsg = hydra::DynamicSceneGraph::load(filepath);
+  }
+
+  if (!dsg) {
+    return false;
+  }
+
   ROS_INFO_STREAM("Loaded dsg: " << dsg->numNodes() << " nodes, " << dsg->numEdges()
                                  << " edges, has mesh? "
                                  << (dsg->hasMesh() ? "yes" : "no"));
   visualizer_->setGraph(dsg);
+  loaded_file_ = file_info;
+  return true;
 }
 
 bool HydraVisualizer::handleReload(std_srvs::Empty::Request&,
                                    std_srvs::Empty::Response&) {
-  loadGraph();
+  // an explicit request always rereads the file
+  loadGraph(true);
   return true;
 }
 
@@ -124,20 +222,23 @@ void HydraVisualizer::spinRos() {
   while (ros::ok()) {
     ros::spinOnce();
 
-    if (receiver_ && receiver_->updated()) {
-      if (!receiver_->graph()) {
+    if (receiver_ && receiver_->consumeUpdate()) {
+      const auto graph = receiver_->graph();
+      if (!graph) {
         r.sleep();
         continue;
       }
       if (!graph_set) {
-        visualizer_->setGraph(receiver_->graph());
+        visualizer_->setGraph(graph);
         graph_set = true;
+      } else if (graph != visualizer_->getGraph()) {
+        // the receiver swaps in a new graph for every update
+        visualizer_->setGraph(graph, false);
       } else {
         visualizer_->setGraphUpdated();
       }
 
       visualizer_->redraw();
-      receiver_->clearUpdated();
     }
 
     r.sleep();
@@ -156,11 +257,10 @@ void HydraVisualizer::spinFile() {
       nh_.advertiseService("reload", &HydraVisualizer::handleReload, this);
   visualizer_->start();
 
-  // Still publish updates if they need to be e.g. redrawn.
+  // markers are latched, so only redraw after a reload or a config or plugin change
   ros::WallRate r(5);
   while (ros::ok()) {
     ros::spinOnce();
-    visualizer_->setGraphUpdated();
     visualizer_->redraw();
     r.sleep();
   }
@@ -0,0 +1,267 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include "hydra_ros/visualizer/mesh_lod.h"
+
+#include <config_utilities/config.h>
+#include <config_utilities/validation.h>
+#include <hydra/utils/pgmo_mesh_traits.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include "hydra_ros/utils/index_hash.h"
+
+namespace hydra {
+
+namespace {
+
+using BlockIndex = MeshLod::BlockIndex;
+
+inline BlockIndex toIndex(const Eigen::Vector3f& point, double size) {
+  return (point.cast<double>() / size).array().floor().cast<int>().matrix();
+}
+
+inline bool isDegenerate(const kimera_pgmo::traits::Face& face) {
+  return face[0] == face[1] || face[1] == face[2] || face[0] == face[2];
+}
+
+}  // namespace
+
+void declare_config(MeshLod::Config& config) {
+  using namespace config;
+  name("MeshLod::Config");
+  field(config.block_size, "block_size");
+  field(config.num_levels, "num_levels");
+  field(config.resolution, "resolution");
+  field(config.lod_distance, "lod_distance");
+  field(config.max_distance, "max_distance");
+
+  check(config.block_size, GT, 0.0, "block_size");
+  check(config.num_levels, GT, 0, "num_levels");
+  check(config.resolution, GT, 0.0, "resolution");
+  check(config.lod_distance, GT, 0.0, "lod_distance");
+}
+
+void MeshLod::Level::clear() {
+  points.clear();
+  colors.clear();
+  faces.clear();
+}
+
+bool MeshLod::Level::operator==(const Level& other) const {
+  return points == other.points && colors == other.colors && faces == other.faces;
+}
+
+MeshLod::MeshLod(const Config& config) : config(config::checkValid(config)) {}
+
+size_t MeshLod::build(const MeshColorAdaptor& mesh) {
+  const size_t num_vertices = pgmoNumVertices(mesh);
+  const size_t num_faces = pgmoNumFaces(mesh);
+  std::unordered_map<BlockIndex, std::vector<size_t>, IndexHash> block_faces;
+  for (size_t i = 0; i < num_faces; ++i) {
+    const auto face = pgmoGetFace(mesh, i);
+    if (face[0] >= num_vertices || face[1] >= num_vertices ||
+        face[2] >= num_vertices) {
+      continue;
+    }
+
+    // faces belong to the block of their first vertex
+    block_faces[toIndex(mesh.mesh.pos(face[0]), config.block_size)].push_back(i);
+  }
+
+  for (auto iter = blocks_.begin(); iter != blocks_.end();) {
+    if (block_faces.count(iter->first)) {
+      ++iter;
+    } else {
+      iter = blocks_.erase(iter);
+    }
+  }
+
+  // maps mesh vertices to block vertices, reset after every block
+  std::vector<size_t> remapping(num_vertices, std::numeric_limits<size_t>::max());
+
+  size_t num_rebuilt = 0;
+  Level original;
+  for (const auto& [index, faces] : block_faces) {
+    original.clear();
+    original.faces.reserve(faces.size());
+    for (const auto face_idx : faces) {
+      auto face = pgmoGetFace(mesh, face_idx);
+      for (auto& vertex : face) {
+        auto& mapped = remapping[vertex];
+        if (mapped == std::numeric_limits<size_t>::max()) {
+          mapped = original.points.size();
+          const auto c = mesh.getVertexColor(vertex);
+          original.points.push_back(mesh.mesh.pos(vertex));
+          original.colors.push_back(kimera_pgmo::traits::Color{{c.r, c.g, c.b, c.a}});
+        }
+
+        vertex = mapped;
+      }
+
+      original.faces.push_back(face);
+    }
+
+    for (const auto face_idx : faces) {
+      for (const auto vertex : pgmoGetFace(mesh, face_idx)) {
+        remapping[vertex] = std::numeric_limits<size_t>::max();
+      }
+    }
+
+    // decimation dominates the cost, so unchanged blocks keep their coarse levels
+    const auto iter = blocks_.find(index);
+    if (iter != blocks_.end() && iter->second.levels.front() == original) {
+      continue;
+    }
+
+    auto& block = blocks_[index];
+    block.center = ((index.cast<double>().array() + 0.5) * config.block_size)
+                       .matrix()
+                       .cast<float>();
+    block.levels.assign(config.num_levels, Level());
+    block.levels.front() = original;
+
+    double voxel_size = config.resolution;
+    for (size_t level = 1; level < config.num_levels; ++level) {
+      decimate(block.levels.front(), voxel_size, block.levels[level]);
+      voxel_size *= 2.0;
+    }
+
+    ++num_rebuilt;
+  }
+
+  return num_rebuilt;
+}
+
+void MeshLod::decimate(const Level& original, double voxel_size, Level& level) const {
+  // vertex clustering: every occupied voxel becomes the average of its vertices
+  std::unordered_map<BlockIndex, size_t, IndexHash> clusters;
+  std::vector<size_t> assignments(original.points.size());
+  std::vector<Eigen::Vector4f> color_sums;
+  std::vector<size_t> counts;
+  for (size_t i = 0; i < original.points.size(); ++i) {
+    const auto& point = original.points[i];
+    const auto iter =
+        clusters.emplace(toIndex(point, voxel_size), level.points.size()).first;
+    const auto cluster = iter->second;
+    if (cluster == level.points.size()) {
+      level.points.push_back(Eigen::Vector3f::Zero());
+      color_sums.push_back(Eigen::Vector4f::Zero());
+      counts.push_back(0);
+    }
+
+    const auto& c = original.colors[i];
+    level.points[cluster] += point;
+    color_sums[cluster] += Eigen::Vector4f(c[0], c[1], c[2], c[3]);
+    ++counts[cluster];
+    assignments[i] = cluster;
+  }
+
+  level.colors.resize(level.points.size());
+  for (size_t i = 0; i < level.points.size(); ++i) {
+    level.points[i] /= counts[i];
+    const Eigen::Vector4f c = color_sums[i] / counts[i];
+    level.colors[i] = kimera_pgmo::traits::Color{{static_cast<uint8_t>(c[0]),
+                                                  static_cast<uint8_t>(c[1]),
+                                                  static_cast<uint8_t>(c[2]),
+                                                  static_cast<uint8_t>(c[3])}};
+  }
+
+  for (const auto& face : original.faces) {
+    kimera_pgmo::traits::Face decimated = face;
+    for (auto& vertex : decimated) {
+      vertex = assignments[vertex];
+    }
+
+    // faces collapsed to a point or a line are dropped
+    if (!isDegenerate(decimated)) {
+      level.faces.push_back(decimated);
+    }
+  }
+}
+
+size_t MeshLod::levelFor(double distance) const {
+  if (distance < config.lod_distance) {
+    return 0;
+  }
+
+  // level k covers [2^(k-1), 2^k) * lod_distance to match the voxel size doubling
+  const auto level = 1 + static_cast<size_t>(std::log2(distance / config.lod_distance));
+  return std::min(level, config.num_levels - 1);
+}
+
+void MeshLod::select(const Eigen::Vector3f& viewpoint, Level& mesh) const {
+  mesh.clear();
+  for (const auto& [index, block] : blocks_) {
+    const double distance = (block.center - viewpoint).norm();
+    if (config.max_distance > 0.0 && distance > config.max_distance) {
+      continue;
+    }
+
+    const auto& level = block.levels.at(levelFor(distance));
+    const size_t offset = mesh.points.size();
+    mesh.points.insert(mesh.points.end(), level.points.begin(), level.points.end());
+    mesh.colors.insert(mesh.colors.end(), level.colors.begin(), level.colors.end());
+    for (auto face : level.faces) {
+      for (auto& vertex : face) {
+        vertex += offset;
+      }
+
+      mesh.faces.push_back(face);
+    }
+  }
+}
+
+size_t pgmoNumVertices(const MeshLod::Level& mesh) { return mesh.points.size(); }
+
+Eigen::Vector3f pgmoGetVertex(const MeshLod::Level& mesh,
+                              size_t i,
+                              kimera_pgmo::traits::VertexTraits* traits) {
+  if (traits) {
+    traits->color = mesh.colors.at(i);
+  }
+
+  return mesh.points.at(i);
+}
+
+size_t pgmoNumFaces(const MeshLod::Level& mesh) { return mesh.faces.size(); }
+
+kimera_pgmo::traits::Face pgmoGetFace(const MeshLod::Level& mesh, size_t i) {
+  return mesh.faces.at(i);
+}
+
+}  // namespace hydra
@@ -41,6 +41,7 @@
 #include <hydra/utils/pgmo_mesh_traits.h>
 #include <kimera_pgmo_msgs/KimeraPgmoMesh.h>
 #include <kimera_pgmo_ros/conversion/ros_conversion.h>
+#include <tf2_eigen/tf2_eigen.h>
 
 #include "hydra_ros/visualizer/mesh_color_adaptor.h"
 
@@ -51,6 +52,11 @@ void declare_config(MeshPlugin::Config& config) {
   name("MeshPlugin::Config");
   field(config.label_colormap, "label_colormap");
   field(config.color_by_label, "color_by_label");
+  field(config.use_lod, "use_lod");
+  field(config.lod, "lod");
+  field(config.lod_viewpoint, "lod_viewpoint");
+
+  check(config.lod_viewpoint.size(), EQ, 3, "lod_viewpoint size");
 }
 
 MeshPlugin::MeshPlugin(const Config& config,
@@ -69,6 +75,17 @@ MeshPlugin::MeshPlugin(const Config& config,
     }
   }
 
+  if (config.use_lod) {
+    lod_.reset(new MeshLod(config.lod));
+    viewpoint_ << config.lod_viewpoint[0], config.lod_viewpoint[1],
+        config.lod_viewpoint[2];
+    // e.g., remapped to the rviz clicked point
+    tf_buffer_.reset(new tf2_ros::Buffer());
+    tf_listener_.reset(new tf2_ros::TransformListener(*tf_buffer_));
+    viewpoint_sub_ =
+        nh_.subscribe("lod_viewpoint", 1, &MeshPlugin::handleViewpoint, this);
+  }
+
   // namespacing gives us a reasonable topic
   mesh_pub_ = nh_.advertise<kimera_pgmo_msgs::KimeraPgmoMesh>("", 1, true);
 }
@@ -89,7 +106,25 @@ void MeshPlugin::draw(const ConfigManager&,
   }
 
   kimera_pgmo_msgs::KimeraPgmoMesh msg;
-  if (color_by_label_ && !invalid_colormap) {
+  if (lod_) {
+    // the blocks can be reused if the draw was only requested for a new viewpoint
+    // (and the mesh didn't visibly change in the meantime)
+    const LodSource source{mesh.get(), mesh->numVertices(), mesh->numFaces()};
+    if (!viewpoint_changed_ || source != lod_source_) {
+      const bool use_coloring = color_by_label_ && !invalid_colormap;
+      const MeshColorAdaptor adaptor(*mesh, use_coloring ? mesh_coloring_ : nullptr);
+      const auto num_rebuilt = lod_->build(adaptor);
+      VLOG(5) << "[MeshPlugin] rebuilt " << num_rebuilt << " / "
+              << lod_->blocks().size() << " lod blocks";
+      lod_source_ = source;
+    }
+
+    frame_id_ = header.frame_id;
+
+    viewpoint_changed_ = false;
+    lod_->select(viewpoint_, lod_mesh_);
+    msg = kimera_pgmo::conversions::toMsg(lod_mesh_);
+  } else if (color_by_label_ && !invalid_colormap) {
     const MeshColorAdaptor adaptor(*mesh, mesh_coloring_);
     msg = kimera_pgmo::conversions::toMsg(adaptor);
   } else {
@@ -112,6 +147,27 @@ std::string MeshPlugin::getMsgNamespace() const {
   return "robot0/dsg_mesh";
 }
 
+void MeshPlugin::handleViewpoint(const geometry_msgs::PointStamped& msg) {
+  Eigen::Vector3d point(msg.point.x, msg.point.y, msg.point.z);
+  const auto& source = msg.header.frame_id;
+  if (!source.empty() && !frame_id_.empty() && source != frame_id_) {
+    try {
+      const auto transform =
+          tf_buffer_->lookupTransform(frame_id_, source, ros::Time(0));
+      point = tf2::transformToEigen(transform) * point;
+    } catch (const tf2::TransformException& e) {
+      ROS_WARN_STREAM("Ignoring lod viewpoint in frame '" << source << "': "
+                                                          << e.what());
+      return;
+    }
+  }
+
+  viewpoint_ = point.cast<float>();
+  // a pending change (e.g., coloring) still requires rebuilding the blocks
+  viewpoint_changed_ = !need_redraw_;
+  need_redraw_ = true;
+}
+
 bool MeshPlugin::hasChange() const { return need_redraw_; }
 
 void MeshPlugin::clearChangeFlag() { need_redraw_ = false; }
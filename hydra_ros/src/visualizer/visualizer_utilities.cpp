@@ -57,6 +57,13 @@ inline double getRatio(double min, double max, double value) {
   return ratio;
 }
 
+template <typename Derived>
+inline void hashMatrix(size_t& seed, const Eigen::MatrixBase<Derived>& matrix) {
+  for (int i = 0; i < matrix.size(); ++i) {
+    hashCombine(seed, std::hash<double>()(matrix(i)));
+  }
+}
+
 inline void fillPoseWithIdentity(geometry_msgs::Pose& pose) {
   Eigen::Vector3d identity_pos = Eigen::Vector3d::Zero();
   tf2::convert(identity_pos, pose.position);
@@ -65,6 +72,83 @@ inline void fillPoseWithIdentity(geometry_msgs::Pose& pose) {
 
 }  // namespace
 
+size_t hashNode(const SceneGraphNode& node) {
+  const auto& attrs = node.attributes();
+  size_t seed = std::hash<NodeId>()(node.id);
+  for (int i = 0; i < 3; ++i) {
+    hashCombine(seed, std::hash<double>()(attrs.position(i)));
+  }
+
+  hashCombine(seed, attrs.last_update_time_ns);
+  hashCombine(seed, attrs.is_active);
+  hashCombine(seed, node.getParent().value_or(0));
+
+  const auto semantic = dynamic_cast<const SemanticNodeAttributes*>(&attrs);
+  if (semantic) {
+    hashCombine(seed, semantic->semantic_label);
+    hashCombine(seed, hashColor(semantic->color));
+    hashCombine(seed, std::hash<std::string>()(semantic->name));
+    const auto& bbox = semantic->bounding_box;
+    hashMatrix(seed, bbox.dimensions);
+    hashMatrix(seed, bbox.world_P_center);
+    hashMatrix(seed, bbox.world_R_center);
+  }
+
+  const auto place = dynamic_cast<const PlaceNodeAttributes*>(&attrs);
+  if (place) {
+    hashCombine(seed, std::hash<double>()(place->distance));
+    hashCombine(seed, place->real_place);
+    hashMatrix(seed, place->frontier_scale);
+    hashMatrix(seed, place->orientation.coeffs());
+  }
+
+  const auto frontier = dynamic_cast<const FrontierNodeAttributes*>(&attrs);
+  if (frontier) {
+    hashCombine(seed, frontier->is_predicted);
+    hashCombine(seed, frontier->active_frontier);
+  }
+
+  const auto place_2d = dynamic_cast<const Place2dNodeAttributes*>(&attrs);
+  if (place_2d) {
+    hashCombine(seed, place_2d->need_cleanup_splitting);
+    hashCombine(seed, place_2d->has_active_mesh_indices);
+    hashMatrix(seed, place_2d->ellipse_centroid);
+    hashMatrix(seed, place_2d->ellipse_matrix_expand);
+    hashCombine(seed, place_2d->boundary.size());
+    for (const auto& point : place_2d->boundary) {
+      hashMatrix(seed, point);
+    }
+
+    // mesh edges are drawn from the connected vertex indices
+    hashCombine(seed, place_2d->pcl_mesh_connections.size());
+    for (const auto index : place_2d->pcl_mesh_connections) {
+      hashCombine(seed, index);
+    }
+  }
+
+  return seed;
+}
+
+size_t hashLayerContents(const SceneGraphLayer& layer) {
+  // node and edge hashes are summed so that the result is independent of ordering
+  size_t nodes_hash = layer.numNodes();
+  for (const auto& id_node_pair : layer.nodes()) {
+    nodes_hash += hashNode(*id_node_pair.second);
+  }
+
+  size_t edges_hash = layer.numEdges();
+  for (const auto& id_edge_pair : layer.edges()) {
+    const auto& edge = id_edge_pair.second;
+    size_t edge_hash = std::hash<NodeId>()(edge.source);
+    hashCombine(edge_hash, edge.target);
+    hashCombine(edge_hash, std::hash<double>()(edge.attributes().weight));
+    edges_hash += edge_hash;
+  }
+
+  hashCombine(nodes_hash, edges_hash);
+  return nodes_hash;
+}
+
 Color getDistanceColor(const VisualizerConfig& config,
                            const ColormapConfig& colors,
                            double distance) {
@@ -585,26 +669,6 @@ Marker makePlaceCentroidMarkers(const std_msgs::Header& header,
   return marker;
 }
 
-namespace {
-
-inline Marker makeNewEdgeList(const std_msgs::Header& header,
-                              const LayerConfig& config,
-                              const std::string& ns_prefix,
-                              LayerId source,
-                              LayerId target) {
-  Marker marker;
-  marker.header = header;
-  marker.type = Marker::LINE_LIST;
-  marker.action = Marker::ADD;
-  marker.id = 0;
-  marker.ns = ns_prefix + std::to_string(source) + "_" + std::to_string(target);
-  marker.scale.x = config.interlayer_edge_scale;
-  fillPoseWithIdentity(marker.pose);
-  return marker;
-}
-
-}  // namespace
-
 bool shouldVisualize(const DynamicSceneGraph& graph,
                      const SceneGraphNode& node,
                      const std::map<LayerId, LayerConfig>& configs,
@@ -628,16 +692,95 @@ LayerId getConfigLayer(const DynamicSceneGraph& graph,
   }
 }
 
-MarkerArray makeDynamicGraphEdgeMarkers(
+EdgeMarkerBuffer::Entry& EdgeMarkerBuffer::entry(LayerId layer, bool& inserted) {
+  for (auto& entry : entries) {
+    if (entry.layer == layer) {
+      inserted = !entry.active;
+      entry.active = true;
+      return entry;
+    }
+  }
+
+  inserted = true;
+  entries.push_back({layer, true, 0, Marker()});
+  return entries.back();
+}
+
+void EdgeMarkerBuffer::clear() {
+  for (auto& entry : entries) {
+    entry.active = false;
+    entry.num_since_last_insertion = 0;
+    entry.marker.points.clear();
+    entry.marker.colors.clear();
+  }
+}
+
+bool EdgeMarkerBuffer::contains(const std::string& ns) const {
+  for (const auto& entry : entries) {
+    if (entry.active && entry.marker.ns == ns) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void EdgeMarkerBuffer::fill(MarkerArray& msg) const {
+  for (const auto& entry : entries) {
+    if (entry.active) {
+      msg.markers.push_back(entry.marker);
+    }
+  }
+}
+
+namespace {
+
+// resets a reused edge list marker and reserves space for its points and colors
+inline void resetEdgeList(const std_msgs::Header& header,
+                          const LayerConfig& config,
+                          const std::string& ns_prefix,
+                          LayerId source,
+                          LayerId target,
+                          size_t num_edges,
+                          Marker& marker) {
+  marker.header = header;
+  marker.type = Marker::LINE_LIST;
+  marker.action = Marker::ADD;
+  marker.id = 0;
+  marker.ns = ns_prefix + std::to_string(source) + "_" + std::to_string(target);
+  marker.scale.x = config.interlayer_edge_scale;
+  marker.color = std_msgs::ColorRGBA();
+  fillPoseWithIdentity(marker.pose);
+  // upper bound on the points from the edges of the source layer
+  const size_t num_points = 2 * num_edges / (config.interlayer_edge_insertion_skip + 1);
+  marker.points.reserve(num_points + 2);
+  marker.colors.reserve(num_points + 2);
+}
+
+// counts the edges that start in each layer
+template <typename Edges>
+std::map<LayerId, size_t> countEdgesBySource(const DynamicSceneGraph& graph,
+                                             const Edges& edges) {
+  std::map<LayerId, size_t> counts;
+  for (const auto& edge : edges) {
+    ++counts[graph.getNode(edge.second.source).layer];
+  }
+
+  return counts;
+}
+
+}  // namespace
+
+void fillDynamicGraphEdgeMarkers(
     const std_msgs::Header& header,
     const DynamicSceneGraph& graph,
     const std::map<LayerId, LayerConfig>& configs,
     const std::map<LayerId, DynamicLayerConfig>& dynamic_configs,
     const VisualizerConfig& visualizer_config,
-    const std::string& ns_prefix) {
-  MarkerArray layer_edges;
-  std::map<LayerId, Marker> layer_markers;
-  std::map<LayerId, size_t> num_since_last_insertion;
+    const std::string& ns_prefix,
+    EdgeMarkerBuffer& buffer) {
+  buffer.clear();
+  const auto num_edges = countEdgesBySource(graph, graph.dynamic_interlayer_edges());
 
   for (const auto& edge : graph.dynamic_interlayer_edges()) {
     const auto& source = graph.getNode(edge.second.source);
@@ -651,28 +794,34 @@ MarkerArray makeDynamicGraphEdgeMarkers(
       continue;
     }
 
-    DynamicLayerConfig config =
+    const DynamicLayerConfig& config =
         dynamic_configs.at(getConfigLayer(graph, source, target));
 
-    size_t num_between_insertions = config.interlayer_edge_insertion_skip;
-
-    if (layer_markers.count(source.layer) == 0) {
-      layer_markers[source.layer] = makeNewEdgeList(
-          header, configs.at(source.layer), ns_prefix, source.layer, target.layer);
-      layer_markers[source.layer].color =
-          makeColorMsg(Color(), config.edge_alpha);
+    const size_t num_between_insertions = config.interlayer_edge_insertion_skip;
+
+    bool inserted;
+    auto& entry = buffer.entry(source.layer, inserted);
+    if (inserted) {
+      resetEdgeList(header,
+                    configs.at(source.layer),
+                    ns_prefix,
+                    source.layer,
+                    target.layer,
+                    num_edges.at(source.layer),
+                    entry.marker);
+      entry.marker.color = makeColorMsg(Color(), config.edge_alpha);
       // make sure we always draw at least one edge
-      num_since_last_insertion[source.layer] = num_between_insertions;
+      entry.num_since_last_insertion = num_between_insertions;
     }
 
-    if (num_since_last_insertion[source.layer] >= num_between_insertions) {
-      num_since_last_insertion[source.layer] = 0;
+    if (entry.num_since_last_insertion >= num_between_insertions) {
+      entry.num_since_last_insertion = 0;
     } else {
-      num_since_last_insertion[source.layer]++;
+      entry.num_since_last_insertion++;
       continue;
     }
 
-    Marker& marker = layer_markers.at(source.layer);
+    Marker& marker = entry.marker;
     geometry_msgs::Point source_point;
     tf2::convert(source.attributes().position, source_point);
     source_point.z += getZOffset(configs.at(source.layer), visualizer_config);
@@ -683,23 +832,34 @@ MarkerArray makeDynamicGraphEdgeMarkers(
     target_point.z += getZOffset(configs.at(target.layer), visualizer_config);
     marker.points.push_back(target_point);
   }
+}
 
-  for (const auto& id_marker_pair : layer_markers) {
-    layer_edges.markers.push_back(id_marker_pair.second);
-  }
+MarkerArray makeDynamicGraphEdgeMarkers(
+    const std_msgs::Header& header,
+    const DynamicSceneGraph& graph,
+    const std::map<LayerId, LayerConfig>& configs,
+    const std::map<LayerId, DynamicLayerConfig>& dynamic_configs,
+    const VisualizerConfig& visualizer_config,
+    const std::string& ns_prefix) {
+  EdgeMarkerBuffer buffer;
+  fillDynamicGraphEdgeMarkers(
+      header, graph, configs, dynamic_configs, visualizer_config, ns_prefix, buffer);
+
+  MarkerArray layer_edges;
+  buffer.fill(layer_edges);
   return layer_edges;
 }
 
 // TODO(nathan) consider making this shorter
-MarkerArray makeGraphEdgeMarkers(const std_msgs::Header& header,
-                                 const DynamicSceneGraph& graph,
-                                 const std::map<LayerId, LayerConfig>& configs,
-                                 const VisualizerConfig& visualizer_config,
-                                 const std::string& ns_prefix,
-                                 const FilterFunction& filter) {
-  MarkerArray layer_edges;
-  std::map<LayerId, Marker> layer_markers;
-  std::map<LayerId, size_t> num_since_last_insertion;
+void fillGraphEdgeMarkers(const std_msgs::Header& header,
+                          const DynamicSceneGraph& graph,
+                          const std::map<LayerId, LayerConfig>& configs,
+                          const VisualizerConfig& visualizer_config,
+                          const std::string& ns_prefix,
+                          EdgeMarkerBuffer& buffer,
+                          const FilterFunction& filter) {
+  buffer.clear();
+  const auto num_edges = countEdgesBySource(graph, graph.interlayer_edges());
 
   for (const auto& edge : graph.interlayer_edges()) {
     const auto& source = graph.getNode(edge.second.source);
@@ -713,51 +873,60 @@ MarkerArray makeGraphEdgeMarkers(const std_msgs::Header& header,
       continue;
     }
 
-    if (!configs.count(source.layer) || !configs.count(target.layer)) {
+    const auto source_config = configs.find(source.layer);
+    const auto target_config = configs.find(target.layer);
+    if (source_config == configs.end() || target_config == configs.end()) {
       continue;
     }
 
-    if (!configs.at(source.layer).visualize) {
+    const LayerConfig& config = source_config->second;
+    if (!config.visualize) {
       continue;
     }
 
-    if (!configs.at(target.layer).visualize) {
+    if (!target_config->second.visualize) {
       continue;
     }
 
-    size_t num_between_insertions =
-        configs.at(source.layer).interlayer_edge_insertion_skip;
+    const size_t num_between_insertions = config.interlayer_edge_insertion_skip;
 
     // parent is always source
     // TODO(nathan) make the above statement an invariant
-    if (layer_markers.count(source.layer) == 0) {
-      layer_markers[source.layer] = makeNewEdgeList(
-          header, configs.at(source.layer), ns_prefix, source.layer, target.layer);
+    bool inserted;
+    auto& entry = buffer.entry(source.layer, inserted);
+    if (inserted) {
+      resetEdgeList(header,
+                    config,
+                    ns_prefix,
+                    source.layer,
+                    target.layer,
+                    num_edges.at(source.layer),
+                    entry.marker);
       // make sure we always draw at least one edge
-      num_since_last_insertion[source.layer] = num_between_insertions;
+      entry.num_since_last_insertion = num_between_insertions;
     }
 
-    if (num_since_last_insertion[source.layer] >= num_between_insertions) {
-      num_since_last_insertion[source.layer] = 0;
+    if (entry.num_since_last_insertion >= num_between_insertions) {
+      entry.num_since_last_insertion = 0;
     } else {
-      num_since_last_insertion[source.layer]++;
+      entry.num_since_last_insertion++;
       continue;
     }
 
-    Marker& marker = layer_markers.at(source.layer);
+    Marker& marker = entry.marker;
     geometry_msgs::Point source_point;
     tf2::convert(source.attributes().position, source_point);
-    source_point.z += getZOffset(configs.at(source.layer), visualizer_config);
+    source_point.z += getZOffset(config, visualizer_config);
     marker.points.push_back(source_point);
 
     geometry_msgs::Point target_point;
     tf2::convert(target.attributes().position, target_point);
-    target_point.z += getZOffset(configs.at(target.layer), visualizer_config);
+    target_point.z += getZOffset(target_config->second, visualizer_config);
     marker.points.push_back(target_point);
 
     Color edge_color;
-    if (configs.at(source.layer).interlayer_edge_use_color) {
-      if (configs.at(source.layer).use_edge_source) {
+    if (config.interlayer_edge_use_color) {
+      if (config.use_edge_source) {
         // TODO(nathan) this might not be a safe cast in general
         edge_color = source.attributes<SemanticNodeAttributes>().color;
       } else {
@@ -768,15 +937,24 @@ MarkerArray makeGraphEdgeMarkers(const std_msgs::Header& header,
       edge_color = Color();
     }
 
-    marker.colors.push_back(
-        makeColorMsg(edge_color, configs.at(source.layer).intralayer_edge_alpha));
-    marker.colors.push_back(
-        makeColorMsg(edge_color, configs.at(source.layer).intralayer_edge_alpha));
+    const auto color_msg = makeColorMsg(edge_color, config.intralayer_edge_alpha);
+    marker.colors.push_back(color_msg);
+    marker.colors.push_back(color_msg);
   }
+}
 
-  for (const auto& id_marker_pair : layer_markers) {
-    layer_edges.markers.push_back(id_marker_pair.second);
-  }
+MarkerArray makeGraphEdgeMarkers(const std_msgs::Header& header,
+                                 const DynamicSceneGraph& graph,
+                                 const std::map<LayerId, LayerConfig>& configs,
+                                 const VisualizerConfig& visualizer_config,
+                                 const std::string& ns_prefix,
+                                 const FilterFunction& filter) {
+  EdgeMarkerBuffer buffer;
+  fillGraphEdgeMarkers(
+      header, graph, configs, visualizer_config, ns_prefix, buffer, filter);
+
+  MarkerArray layer_edges;
+  buffer.fill(layer_edges);
   return layer_edges;
 }
 
@@ -801,6 +979,20 @@ Marker makeMeshEdgesMarker(const std_msgs::Header& header,
     return marker;
   }
 
+  const size_t stride = config.interlayer_edge_insertion_skip + 1;
+  size_t num_points = 0;
+  for (const auto& id_node_pair : layer.nodes()) {
+    const auto& attrs = id_node_pair.second->attributes<Place2dNodeAttributes>();
+    const size_t num_connections = attrs.pcl_mesh_connections.size();
+    if (num_connections) {
+      num_points += 2 + 2 * ((num_connections + stride - 1) / stride);
+    }
+  }
+
+  marker.points.reserve(num_points);
+  marker.colors.reserve(num_points);
+
+  const auto default_color = makeColorMsg(Color(), config.interlayer_edge_alpha);
   for (const auto& id_node_pair : layer.nodes()) {
     const auto& node = *id_node_pair.second;
     const auto& attrs = node.attributes<Place2dNodeAttributes>();
@@ -809,6 +1001,10 @@ Marker makeMeshEdgesMarker(const std_msgs::Header& header,
       continue;
     }
 
+    const auto color = config.interlayer_edge_use_color
+                           ? makeColorMsg(attrs.color, config.interlayer_edge_alpha)
+                           : default_color;
+
     geometry_msgs::Point center_point;
     tf2::convert(attrs.position, center_point);
     center_point.z +=
@@ -821,20 +1017,13 @@ Marker makeMeshEdgesMarker(const std_msgs::Header& header,
     // make first edge
     marker.points.push_back(centroid_location);
     marker.points.push_back(center_point);
-    if (config.interlayer_edge_use_color) {
-      marker.colors.push_back(makeColorMsg(attrs.color, config.interlayer_edge_alpha));
-      marker.colors.push_back(makeColorMsg(attrs.color, config.interlayer_edge_alpha));
-    } else {
-      marker.colors.push_back(
-          makeColorMsg(Color(), config.interlayer_edge_alpha));
-      marker.colors.push_back(
-          makeColorMsg(Color(), config.interlayer_edge_alpha));
-    }
+    marker.colors.push_back(color);
+    marker.colors.push_back(color);
 
     size_t i = 0;
     for (const auto midx : mesh_edge_indices) {
       ++i;
-      if ((i - 1) % (config.interlayer_edge_insertion_skip + 1) != 0) {
+      if ((i - 1) % stride != 0) {
         continue;
       }
 
@@ -851,18 +1040,8 @@ Marker makeMeshEdgesMarker(const std_msgs::Header& header,
 
       marker.points.push_back(center_point);
       marker.points.push_back(vertex);
-
-      if (config.interlayer_edge_use_color) {
-        marker.colors.push_back(
-            makeColorMsg(attrs.color, config.interlayer_edge_alpha));
-        marker.colors.push_back(
-            makeColorMsg(attrs.color, config.interlayer_edge_alpha));
-      } else {
-        marker.colors.push_back(
-            makeColorMsg(Color(), config.interlayer_edge_alpha));
-        marker.colors.push_back(
-            makeColorMsg(Color(), config.interlayer_edge_alpha));
-      }
+      marker.colors.push_back(color);
+      marker.colors.push_back(color);
     }
   }
 
@@ -927,6 +1106,8 @@ MarkerArray makeGvdWireframe(const std_msgs::Header& header,
     return marker;
   }
 
+  nodes.points.reserve(layer.numNodes());
+  nodes.colors.reserve(layer.numNodes());
   for (const auto& id_node_pair : layer.nodes()) {
     geometry_msgs::Point node_centroid;
     tf2::convert(id_node_pair.second->attributes().position, node_centroid);
@@ -941,6 +1122,8 @@ MarkerArray makeGvdWireframe(const std_msgs::Header& header,
     return marker;
   }
 
+  edges.points.reserve(2 * layer.numEdges());
+  edges.colors.reserve(2 * layer.numEdges());
   for (const auto& id_edge_pair : layer.edges()) {
     // TODO(nathan) filter by node symbol category
     const auto& edge = id_edge_pair.second;
@@ -1020,10 +1203,21 @@ Marker makeLayerEdgeMarkers(const std_msgs::Header& header,
   marker.scale.x = config.intralayer_edge_scale;
   fillPoseWithIdentity(marker.pose);
 
-  auto edge_iter = layer.edges().begin();
-  while (edge_iter != layer.edges().end()) {
-    const auto& source_node = layer.getNode(edge_iter->second.source);
-    const auto& target_node = layer.getNode(edge_iter->second.target);
+  const size_t stride = config.intralayer_edge_insertion_skip + 1;
+  const size_t num_points = 2 * ((layer.numEdges() + stride - 1) / stride);
+  marker.points.reserve(num_points);
+  marker.colors.reserve(num_points);
+
+  size_t i = 0;
+  for (const auto& id_edge_pair : layer.edges()) {
+    ++i;
+    if ((i - 1) % stride != 0) {
+      continue;
+    }
+
+    const auto& edge = id_edge_pair.second;
+    const auto& source_node = layer.getNode(edge.source);
+    const auto& target_node = layer.getNode(edge.target);
     if (filter && (!filter(source_node) || !filter(target_node))) {
       continue;
     }
@@ -1038,14 +1232,11 @@ Marker makeLayerEdgeMarkers(const std_msgs::Header& header,
     target.z += getZOffset(config, visualizer_config);
     marker.points.push_back(target);
 
+    const auto& alpha = config.intralayer_edge_alpha;
     marker.colors.push_back(
-        makeColorMsg(color_func(source_node, target_node, edge_iter->second, true),
-                     config.intralayer_edge_alpha));
+        makeColorMsg(color_func(source_node, target_node, edge, true), alpha));
     marker.colors.push_back(
-        makeColorMsg(color_func(source_node, target_node, edge_iter->second, false),
-                     config.intralayer_edge_alpha));
-
-    std::advance(edge_iter, config.intralayer_edge_insertion_skip + 1);
+        makeColorMsg(color_func(source_node, target_node, edge, false), alpha));
   }
 
   return marker;
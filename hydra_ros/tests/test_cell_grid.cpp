@@ -0,0 +1,228 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <hydra_ros/utils/cell_grid.h>
+
+namespace hydra {
+
+using Index = CellGrid::Index;
+
+inline int8_t cellValue(const Index& cell) {
+  return wrap(7 * cell.x() + 3 * cell.y(), 100);
+}
+
+TEST(CellGrid, GrowAlignsToChunks) {
+  CellGrid grid;
+  grid.voxels_per_side = 4;
+
+  // columns -1 to 2 with two column chunks cover columns [-2, 4)
+  EXPECT_TRUE(grid.grow(Index(-1, 0), Index(2, 1), 2));
+  EXPECT_EQ(grid.origin, Index(-8, 0));
+  EXPECT_EQ(grid.size, Index(24, 8));
+  EXPECT_EQ(grid.data.size(), 24u * 8u);
+  for (const auto cell : grid.data) {
+    EXPECT_EQ(cell, -1);
+  }
+
+  // columns already inside the grid don't resize it
+  EXPECT_FALSE(grid.grow(Index(-2, 0), Index(3, 1), 2));
+  EXPECT_EQ(grid.size, Index(24, 8));
+}
+
+TEST(CellGrid, GrowKeepsCells) {
+  CellGrid grid;
+  grid.voxels_per_side = 2;
+  grid.grow(Index(0, 0), Index(0, 0), 1);
+  ASSERT_EQ(grid.size, Index(2, 2));
+  grid.data = {0, 1, 2, 3};
+
+  EXPECT_TRUE(grid.grow(Index(-1, 1), Index(-1, 1), 1));
+  EXPECT_EQ(grid.origin, Index(-2, 0));
+  EXPECT_EQ(grid.size, Index(4, 4));
+  const std::vector<int8_t> expected{-1, -1, 0, 1, -1, -1, 2, 3,
+                                     -1, -1, -1, -1, -1, -1, -1, -1};
+  EXPECT_EQ(grid.data, expected);
+}
+
+TEST(CellGrid, CellIndex) {
+  CellGrid grid;
+  grid.voxels_per_side = 2;
+  grid.grow(Index(-1, -1), Index(0, 0), 1);
+  ASSERT_EQ(grid.origin, Index(-2, -2));
+  ASSERT_EQ(grid.size, Index(4, 4));
+
+  EXPECT_EQ(grid.cellIndex(Index(-2, -2)), 0u);
+  EXPECT_EQ(grid.cellIndex(Index(1, -2)), 3u);
+  EXPECT_EQ(grid.cellIndex(Index(-2, -1)), 4u);
+  EXPECT_EQ(grid.cellIndex(Index(1, 1)), 15u);
+  EXPECT_EQ(grid.cellIndex(Index(-3, 0)), CellGrid::INVALID);
+  EXPECT_EQ(grid.cellIndex(Index(2, 0)), CellGrid::INVALID);
+  EXPECT_EQ(grid.cellIndex(Index(0, 2)), CellGrid::INVALID);
+
+  EXPECT_TRUE(grid.overlaps(Index(-1, 0)));
+  EXPECT_FALSE(grid.overlaps(Index(1, 0)));
+  EXPECT_FALSE(grid.overlaps(Index(0, -2)));
+}
+
+TEST(CellGrid, CopyRegion) {
+  CellGrid grid;
+  grid.voxels_per_side = 2;
+  grid.grow(Index(0, 0), Index(1, 1), 2);
+  ASSERT_EQ(grid.size, Index(4, 4));
+  for (size_t i = 0; i < grid.data.size(); ++i) {
+    grid.data[i] = i;
+  }
+
+  CellGrid::Bounds bounds;
+  EXPECT_TRUE(bounds.empty());
+  bounds.add(grid, Index(1, 0));
+  EXPECT_FALSE(bounds.empty());
+  EXPECT_EQ(bounds.min, Index(2, 0));
+  EXPECT_EQ(bounds.max, Index(3, 1));
+
+  std::vector<int8_t> region;
+  auto copied = grid.copyRegion(bounds, region);
+  EXPECT_EQ(copied.min, Index(2, 0));
+  EXPECT_EQ(copied.max, Index(3, 1));
+  EXPECT_EQ(region, std::vector<int8_t>({2, 3, 6, 7}));
+
+  // regions are clipped to the grid
+  bounds.add(grid, Index(2, 1));
+  copied = grid.copyRegion(bounds, region);
+  EXPECT_EQ(copied.min, Index(2, 0));
+  EXPECT_EQ(copied.max, Index(3, 3));
+  EXPECT_EQ(region, std::vector<int8_t>({2, 3, 6, 7, 10, 11, 14, 15}));
+
+  CellGrid::Bounds outside;
+  outside.add(grid, Index(5, 5));
+  copied = grid.copyRegion(outside, region);
+  EXPECT_TRUE(copied.empty());
+  EXPECT_TRUE(region.empty());
+}
+
+// fills every cell of the window with a value unique to its position
+void fillWindow(CellGrid& grid) {
+  for (int y = grid.origin.y(); y < grid.origin.y() + grid.size.y(); ++y) {
+    for (int x = grid.origin.x(); x < grid.origin.x() + grid.size.x(); ++x) {
+      grid.ring.at(grid.cellIndex(Index(x, y))) = cellValue(Index(x, y));
+    }
+  }
+}
+
+// checks the unwrapped window against the cells that were visible before a move
+void checkWindow(CellGrid& grid, const Index& old_origin) {
+  grid.unwrap();
+  for (int r = 0; r < grid.size.y(); ++r) {
+    for (int c = 0; c < grid.size.x(); ++c) {
+      const Index cell = grid.origin + Index(c, r);
+      const Index old_rel = cell - old_origin;
+      const bool was_visible =
+          (old_rel.array() >= 0).all() && (old_rel.array() < grid.size.array()).all();
+      const int8_t expected = was_visible ? cellValue(cell) : -1;
+      EXPECT_EQ(grid.data.at(r * grid.size.x() + c), expected)
+          << "cell (" << cell.x() << ", " << cell.y() << ")";
+    }
+  }
+}
+
+TEST(CellGrid, RollingCellIndexWraps) {
+  CellGrid grid;
+  grid.voxel_size = 0.5f;
+  grid.voxels_per_side = 2;
+  grid.initWindow(Index(4, 3), Eigen::Vector2d(-2.75, -0.25));
+  EXPECT_EQ(grid.origin, Index(-8, -2));
+
+  // every cell of the window maps to a different ring entry
+  std::vector<bool> used(grid.ring.size(), false);
+  for (int y = -2; y < 1; ++y) {
+    for (int x = -8; x < -4; ++x) {
+      const auto index = grid.cellIndex(Index(x, y));
+      ASSERT_LT(index, used.size());
+      EXPECT_FALSE(used[index]);
+      used[index] = true;
+    }
+  }
+
+  EXPECT_EQ(grid.cellIndex(Index(-8, -2)), 4u);
+  EXPECT_EQ(grid.cellIndex(Index(-5, 0)), 3u);
+  EXPECT_EQ(grid.cellIndex(Index(-9, -2)), CellGrid::INVALID);
+  EXPECT_EQ(grid.cellIndex(Index(-4, -2)), CellGrid::INVALID);
+  EXPECT_EQ(grid.cellIndex(Index(-8, 1)), CellGrid::INVALID);
+}
+
+TEST(CellGrid, RecenterKeepsVisibleCells) {
+  CellGrid grid;
+  grid.voxel_size = 1.0f;
+  grid.voxels_per_side = 2;
+  grid.initWindow(Index(5, 4), Eigen::Vector2d(0.5, 0.5));
+  fillWindow(grid);
+  checkWindow(grid, grid.origin);
+
+  // moves that stay on the same cell don't change anything
+  EXPECT_FALSE(grid.recenter(Eigen::Vector2d(0.9, 0.1)));
+
+  // moves across zero in both directions
+  for (const auto& position : {Eigen::Vector2d(-1.5, 0.5),
+                               Eigen::Vector2d(-3.5, -2.5),
+                               Eigen::Vector2d(-1.5, 1.5),
+                               Eigen::Vector2d(2.5, -0.5)}) {
+    fillWindow(grid);
+    const Index old_origin = grid.origin;
+    EXPECT_TRUE(grid.recenter(position));
+    checkWindow(grid, old_origin);
+  }
+}
+
+TEST(CellGrid, RecenterPastWindowClearsEverything) {
+  CellGrid grid;
+  grid.voxel_size = 1.0f;
+  grid.voxels_per_side = 2;
+  grid.initWindow(Index(4, 4), Eigen::Vector2d(-10.5, 3.5));
+  for (const auto& position : {Eigen::Vector2d(20.5, 3.5),
+                               Eigen::Vector2d(-30.5, -40.5),
+                               Eigen::Vector2d(-30.5, -44.5),
+                               Eigen::Vector2d(-25.5, -47.5)}) {
+    fillWindow(grid);
+    const Index old_origin = grid.origin;
+    EXPECT_TRUE(grid.recenter(position));
+    for (const auto cell : grid.ring) {
+      EXPECT_EQ(cell, -1);
+    }
+
+    checkWindow(grid, old_origin);
+  }
+}
+
+}  // namespace hydra
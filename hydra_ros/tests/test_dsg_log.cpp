@@ -0,0 +1,165 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <hydra_ros/utils/dsg_log.h>
+
+#include <cstdio>
+#include <filesystem>
+
+namespace hydra {
+
+namespace {
+
+std::string logPath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void writeLog(const std::string& path) {
+  DsgLogWriter writer(path);
+  for (uint8_t i = 0; i < 5; ++i) {
+    std::vector<uint8_t> data(i + 1, i);
+    // every other record is a keyframe
+    EXPECT_TRUE(writer.write(10 * (i + 1), i, i % 2 == 0, data.data(), data.size()));
+  }
+  EXPECT_EQ(writer.numRecords(), 5u);
+}
+
+}  // namespace
+
+TEST(DsgLog, ReadBack) {
+  const auto path = logPath("test_dsg_log_read_back.log");
+  writeLog(path);
+
+  DsgLogReader reader(path);
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(reader.keyframes().size(), 3u);
+  EXPECT_EQ(reader.startTime(), 10u);
+  EXPECT_EQ(reader.endTime(), 50u);
+
+  DsgLogRecord record;
+  for (uint8_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.stamp_ns, 10u * (i + 1));
+    EXPECT_EQ(record.sequence_number, i);
+    EXPECT_EQ(record.full_update, i % 2 == 0);
+    EXPECT_EQ(record.contents, std::vector<uint8_t>(i + 1, i));
+  }
+  EXPECT_FALSE(reader.next(record));
+}
+
+TEST(DsgLog, ReadDeletions) {
+  const auto path = logPath("test_dsg_log_deletions.log");
+  {
+    DsgLogWriter writer(path);
+    const std::vector<uint8_t> data{1, 2, 3};
+    EXPECT_TRUE(writer.write(10, 0, true, data.data(), data.size()));
+    EXPECT_TRUE(writer.write(20, 1, false, data.data(), data.size(), {5}, {6, 7}));
+  }
+
+  DsgLogReader reader(path);
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(reader.keyframes().size(), 1u);
+
+  DsgLogRecord record;
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_TRUE(record.deleted_nodes.empty());
+  EXPECT_TRUE(record.deleted_edges.empty());
+
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.contents, std::vector<uint8_t>({1, 2, 3}));
+  EXPECT_EQ(record.deleted_nodes, std::vector<uint64_t>({5}));
+  EXPECT_EQ(record.deleted_edges, std::vector<uint64_t>({6, 7}));
+  EXPECT_FALSE(reader.next(record));
+}
+
+TEST(DsgLog, SeekToKeyframe) {
+  const auto path = logPath("test_dsg_log_seek.log");
+  writeLog(path);
+
+  DsgLogReader reader(path);
+  DsgLogRecord record;
+  ASSERT_TRUE(reader.seek(45));
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.stamp_ns, 30u);
+
+  ASSERT_TRUE(reader.seek(0));
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.stamp_ns, 10u);
+
+  ASSERT_TRUE(reader.seek(100));
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.stamp_ns, 50u);
+  EXPECT_FALSE(reader.next(record));
+}
+
+TEST(DsgLog, ViewKeyframe) {
+  const auto path = logPath("test_dsg_log_view.log");
+  writeLog(path);
+
+  DsgLogReader reader(path);
+  const auto index = reader.findKeyframe(45);
+  ASSERT_TRUE(index);
+  EXPECT_EQ(*index, 1u);
+
+  std::vector<uint8_t> contents;
+  EXPECT_TRUE(reader.viewKeyframe(*index, [&](const uint8_t* data, size_t size) {
+    contents.assign(data, data + size);
+  }));
+  EXPECT_EQ(contents, std::vector<uint8_t>(3, 2));
+  EXPECT_FALSE(reader.viewKeyframe(3, [](const uint8_t*, size_t) {}));
+}
+
+TEST(DsgLog, RebuildIndex) {
+  const auto path = logPath("test_dsg_log_rebuild.log");
+  writeLog(path);
+  std::remove(DsgLogWriter::indexPath(path).c_str());
+
+  // truncate the last record
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 2);
+
+  DsgLogReader reader(path);
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(reader.keyframes().size(), 2u);
+  EXPECT_EQ(reader.endTime(), 30u);
+
+  DsgLogRecord record;
+  size_t num_read = 0;
+  while (reader.next(record)) {
+    ++num_read;
+  }
+  EXPECT_EQ(num_read, 4u);
+}
+
+}  // namespace hydra
@@ -0,0 +1,98 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <hydra_ros/utils/freespace_index.h>
+
+namespace hydra {
+
+TEST(FreespaceIndex, SinglePointQueries) {
+  FreespaceIndex index(1.0);
+  index.insert(0, Eigen::Vector3d::Zero(), 1.0);
+  index.insert(1, Eigen::Vector3d(5.0, 0.0, 0.0), 2.5);
+  EXPECT_EQ(index.size(), 2u);
+
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d(0.5, 0.0, 0.0)));
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d(0.5, 0.0, 0.0), 0.6));
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d(1.5, 0.0, 0.0)));
+  // only found if the sphere is stored in cells past its center's neighbors
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d(3.0, 0.0, 0.0)));
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d(3.0, 0.0, 0.0), 1.0));
+}
+
+TEST(FreespaceIndex, BatchMatchesSingle) {
+  FreespaceIndex index(0.5);
+  index.insert(0, Eigen::Vector3d(0.0, 0.0, 0.0), 1.0);
+  index.insert(1, Eigen::Vector3d(1.5, 1.0, 0.0), 0.8);
+  index.insert(2, Eigen::Vector3d(-2.0, 0.5, 1.0), 1.2);
+
+  Eigen::Matrix3Xd points = Eigen::Matrix3Xd::Random(3, 200) * 3.0;
+  const auto result = index.batchInFreespace(points, 0.1);
+  ASSERT_EQ(result.size(), 200u);
+  for (int i = 0; i < points.cols(); ++i) {
+    EXPECT_EQ(result[i] != 0, index.inFreespace(points.col(i), 0.1)) << "point " << i;
+  }
+}
+
+TEST(FreespaceIndex, MoveAndErase) {
+  FreespaceIndex index(1.0);
+  index.insert(0, Eigen::Vector3d::Zero(), 1.0);
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d::Zero()));
+
+  index.insert(0, Eigen::Vector3d(10.0, 0.0, 0.0), 1.0);
+  EXPECT_EQ(index.size(), 1u);
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d::Zero()));
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d(10.0, 0.0, 0.0)));
+
+  index.erase(0);
+  EXPECT_EQ(index.size(), 0u);
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d(10.0, 0.0, 0.0)));
+}
+
+TEST(FreespaceIndex, ShrinkRadius) {
+  FreespaceIndex index(1.0);
+  index.insert(0, Eigen::Vector3d::Zero(), 3.0);
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d(2.5, 0.0, 0.0)));
+
+  index.insert(0, Eigen::Vector3d::Zero(), 0.5);
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d(2.5, 0.0, 0.0)));
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d(0.2, 0.0, 0.0)));
+
+  // negative cells hash to distinct buckets
+  index.insert(1, Eigen::Vector3d(-4.0, -4.0, -4.0), 0.5);
+  EXPECT_TRUE(index.inFreespace(Eigen::Vector3d(-4.2, -4.0, -4.0)));
+  EXPECT_FALSE(index.inFreespace(Eigen::Vector3d(4.2, 4.0, 4.0)));
+}
+
+}  // namespace hydra
@@ -0,0 +1,133 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <hydra_ros/utils/shared_memory_ring.h>
+
+#include <numeric>
+#include <thread>
+
+namespace hydra {
+
+TEST(SharedMemoryRing, SegmentName) {
+  EXPECT_EQ(SharedMemoryRing::segmentName("/robot/backend/dsg"),
+            "/hydra_robot_backend_dsg");
+}
+
+TEST(SharedMemoryRing, WriteAndRead) {
+  const auto name = SharedMemoryRing::segmentName("test_write_and_read");
+  auto writer = SharedMemoryRing::create(name, 2, 16);
+  ASSERT_TRUE(writer);
+  auto reader = SharedMemoryRing::open(name);
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(reader->numSlots(), 2u);
+  EXPECT_GE(reader->slotCapacity(), 16u);
+  EXPECT_EQ(reader->instanceId(), writer->instanceId());
+
+  std::vector<uint8_t> data(10);
+  std::iota(data.begin(), data.end(), 0);
+  const auto token = writer->write(data.data(), data.size());
+  ASSERT_TRUE(token);
+
+  std::vector<uint8_t> result;
+  EXPECT_TRUE(reader->read(*token, [&](const uint8_t* buffer, size_t size) {
+    result.assign(buffer, buffer + size);
+  }));
+  EXPECT_EQ(result, data);
+
+  // too large for a slot
+  std::vector<uint8_t> large(1024);
+  EXPECT_FALSE(writer->write(large.data(), large.size()));
+}
+
+TEST(SharedMemoryRing, OverwrittenSlotRejected) {
+  const auto name = SharedMemoryRing::segmentName("test_overwritten");
+  auto writer = SharedMemoryRing::create(name, 2, 16);
+  auto reader = SharedMemoryRing::open(name);
+  ASSERT_TRUE(writer && reader);
+
+  uint8_t value = 1;
+  const auto first = writer->write(&value, 1);
+  writer->write(&value, 1);
+  writer->write(&value, 1);
+  ASSERT_TRUE(first);
+  EXPECT_FALSE(reader->read(*first, [](const uint8_t*, size_t) {}));
+}
+
+TEST(SharedMemoryRing, WriterSkipsSlotsBeingRead) {
+  const auto name = SharedMemoryRing::segmentName("test_skip_reading");
+  auto writer = SharedMemoryRing::create(name, 2, 16);
+  auto reader = SharedMemoryRing::open(name);
+  ASSERT_TRUE(writer && reader);
+
+  uint8_t value = 1;
+  const auto first = writer->write(&value, 1);
+  ASSERT_TRUE(first);
+  EXPECT_TRUE(reader->read(*first, [&](const uint8_t* buffer, size_t) {
+    // both writes have to avoid the pinned slot
+    uint8_t other = 2;
+    const auto second = writer->write(&other, 1);
+    ASSERT_TRUE(second);
+    EXPECT_NE(second->slot, first->slot);
+    const auto third = writer->write(&other, 1);
+    ASSERT_TRUE(third);
+    EXPECT_NE(third->slot, first->slot);
+    EXPECT_EQ(buffer[0], 1);
+  }));
+}
+
+TEST(SharedMemoryRing, StaleReaderReclaimed) {
+  const auto name = SharedMemoryRing::segmentName("test_stale_reader");
+  auto writer = SharedMemoryRing::create(name, 1, 16, 0.01);
+  auto reader = SharedMemoryRing::open(name);
+  ASSERT_TRUE(writer && reader);
+
+  uint8_t value = 1;
+  const auto first = writer->write(&value, 1);
+  ASSERT_TRUE(first);
+  // the reader stalls past the timeout: the writer takes the slot back and the read
+  // reports that its data was overwritten
+  EXPECT_FALSE(reader->read(*first, [&](const uint8_t*, size_t) {
+    EXPECT_FALSE(writer->write(&value, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(writer->write(&value, 1));
+  }));
+
+  // the reader count is not corrupted by the reclaim
+  const auto last = writer->write(&value, 1);
+  ASSERT_TRUE(last);
+  EXPECT_TRUE(reader->read(*last, [](const uint8_t*, size_t) {}));
+}
+
+}  // namespace hydra
@@ -0,0 +1,82 @@
+/* -----------------------------------------------------------------------------
+ * Copyright 2022 Massachusetts Institute of Technology.
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Research was sponsored by the United States Air Force Research Laboratory and
+ * the United States Air Force Artificial Intelligence Accelerator and was
+ * accomplished under Cooperative Agreement Number FA8750-19-2-1000. The views
+ * and conclusions contained in this document are those of the authors and should
+ * not be interpreted as representing the official policies, either expressed or
+ * implied, of the United States Air Force or the U.S. Government. The U.S.
+ * Government is authorized to reproduce and distribute reprints for Government
+ * purposes notwithstanding any copyright notation herein.
+ * -------------------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <hydra_ros/utils/task_pool.h>
+
+#include <atomic>
+#include <stdexcept>
+
+namespace hydra {
+
+TEST(TaskPool, RunsEveryTask) {
+  for (const size_t num_threads : {0, 1, 4}) {
+    TaskPool pool(num_threads);
+    EXPECT_EQ(pool.numThreads(), num_threads);
+
+    // batches can be run repeatedly
+    for (size_t batch = 0; batch < 3; ++batch) {
+      std::vector<int> results(100, 0);
+      std::vector<TaskPool::Task> tasks;
+      for (size_t i = 0; i < results.size(); ++i) {
+        tasks.push_back([&results, i]() { results[i] = i; });
+      }
+
+      pool.run(tasks);
+      for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i], static_cast<int>(i));
+      }
+    }
+  }
+}
+
+TEST(TaskPool, RethrowsErrors) {
+  TaskPool pool(2);
+  std::atomic<size_t> num_run(0);
+  std::vector<TaskPool::Task> tasks;
+  for (size_t i = 0; i < 10; ++i) {
+    tasks.push_back([&num_run, i]() {
+      ++num_run;
+      if (i == 5) {
+        throw std::runtime_error("failed");
+      }
+    });
+  }
+
+  EXPECT_THROW(pool.run(tasks), std::runtime_error);
+  // the remaining tasks still finish
+  EXPECT_EQ(num_run, 10u);
+}
+
+}  // namespace hydra